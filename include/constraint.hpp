@@ -15,7 +15,7 @@ namespace internal
 //     p_1*x_1 + p_2*x_2 + ... + b == 0
 struct EqualityConstraint
 {
-    explicit EqualityConstraint(const internal::AffineSum &affine);
+    explicit EqualityConstraint(internal::AffineSum affine);
     internal::AffineSum affine;
     friend std::ostream &operator<<(std::ostream &os, const EqualityConstraint &constraint);
     double evaluate(const std::vector<double> &soln_values) const;
@@ -25,7 +25,7 @@ struct EqualityConstraint
 //     p_1*x_1 + p_2*x_2 + ... + b >= 0
 struct PositiveConstraint
 {
-    explicit PositiveConstraint(const internal::AffineSum &affine);
+    explicit PositiveConstraint(internal::AffineSum affine);
     internal::AffineSum affine;
     friend std::ostream &operator<<(std::ostream &os, const PositiveConstraint &constraint);
     double evaluate(const std::vector<double> &soln_values) const;
@@ -36,7 +36,7 @@ struct PositiveConstraint
 //        <= p_5*x_5 + p_6*x_6 + ... + b_3
 struct SecondOrderConeConstraint
 {
-    SecondOrderConeConstraint(const internal::Norm2Term &norm2, const internal::AffineSum &affine);
+    SecondOrderConeConstraint(internal::Norm2Term norm2, internal::AffineSum affine);
     internal::Norm2Term norm2;
     internal::AffineSum affine;
     friend std::ostream &operator<<(std::ostream &os, const SecondOrderConeConstraint &constraint);
@@ -45,14 +45,16 @@ struct SecondOrderConeConstraint
 
 } // namespace internal
 
-std::vector<internal::EqualityConstraint> operator==(const Affine &affine, const double zero);
-std::vector<internal::EqualityConstraint> operator==(const Affine &lhs, const Affine &rhs);
+// The expressions are taken by value so that the coefficients of temporaries
+// are moved into the constraints instead of being copied.
+std::vector<internal::EqualityConstraint> operator==(Affine affine, const double zero);
+std::vector<internal::EqualityConstraint> operator==(Affine lhs, Affine rhs);
 
-std::vector<internal::PositiveConstraint> operator>=(const Affine &affine, const double zero);
-std::vector<internal::PositiveConstraint> operator<=(const double zero, const Affine &affine);
-std::vector<internal::PositiveConstraint> operator>=(const Affine &lhs, const Affine &rhs);
-std::vector<internal::PositiveConstraint> operator<=(const Affine &lhs, const Affine &rhs);
+std::vector<internal::PositiveConstraint> operator>=(Affine affine, const double zero);
+std::vector<internal::PositiveConstraint> operator<=(const double zero, Affine affine);
+std::vector<internal::PositiveConstraint> operator>=(Affine lhs, Affine rhs);
+std::vector<internal::PositiveConstraint> operator<=(Affine lhs, Affine rhs);
 
-std::vector<internal::SecondOrderConeConstraint> operator<=(const SOCLhs &socLhs, const Affine &affine);
+std::vector<internal::SecondOrderConeConstraint> operator<=(SOCLhs socLhs, Affine affine);
 
 } // namespace op
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <vector>
 #include <cassert>
 #include <memory>
+#include <utility>
+#include <algorithm>
 
 namespace op
 {
@@ -15,18 +17,26 @@ T vstack(const std::initializer_list<T> elements)
         return *elements.begin();
     }
 
-    T stacked = *elements.begin();
-    for (auto e_ptr = std::next(elements.begin()); e_ptr != elements.end(); e_ptr++)
+    size_t rows = 0;
+    const size_t cols = elements.begin()->cols();
+    for (const T &e : elements)
     {
-        assert(stacked.cols() == e_ptr->cols());
-
-        const size_t start_row = stacked.rows();
-        stacked.resize(start_row + e_ptr->rows(), stacked.cols());
+        assert(e.cols() == cols);
+        rows += e.rows();
+    }
 
-        for (auto [row, col] : e_ptr->all_indices())
+    T stacked(rows, cols);
+    size_t start_row = 0;
+    for (const T &e : elements)
+    {
+        for (size_t col = 0; col < cols; col++)
         {
-            stacked.coeffRef(start_row + row, col) = e_ptr->coeff(row, col);
+            for (size_t row = 0; row < e.rows(); row++)
+            {
+                stacked.coeffRef(start_row + row, col) = e.coeff(row, col);
+            }
         }
+        start_row += e.rows();
     }
     return stacked;
 }
@@ -39,22 +49,63 @@ T hstack(const std::initializer_list<T> elements)
         return *elements.begin();
     }
 
-    T stacked = *elements.begin();
-    for (auto e_ptr = std::next(elements.begin()); e_ptr != elements.end(); e_ptr++)
+    const size_t rows = elements.begin()->rows();
+    size_t cols = 0;
+    for (const T &e : elements)
     {
-        assert(stacked.rows() == e_ptr->rows());
-
-        const size_t start_col = stacked.cols();
-        stacked.resize(stacked.rows(), start_col + e_ptr->cols());
+        assert(e.rows() == rows);
+        cols += e.cols();
+    }
 
-        for (auto [row, col] : e_ptr->all_indices())
+    T stacked(rows, cols);
+    size_t start_col = 0;
+    for (const T &e : elements)
+    {
+        for (size_t col = 0; col < e.cols(); col++)
         {
-            stacked.coeffRef(row, start_col + col) = e_ptr->coeff(row, col);
+            for (size_t row = 0; row < rows; row++)
+            {
+                stacked.coeffRef(row, start_col + col) = e.coeff(row, col);
+            }
         }
+        start_col += e.cols();
     }
     return stacked;
 }
 
+// The (row, col) pairs of a matrix in row major order, computed while iterating
+class IndexRange
+{
+public:
+    class iterator
+    {
+    public:
+        iterator(size_t index, size_t cols) : index(index), cols(cols) {}
+        std::pair<size_t, size_t> operator*() const { return {index / cols, index % cols}; }
+        iterator &operator++()
+        {
+            index++;
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return index != other.index; }
+
+    private:
+        size_t index;
+        size_t cols;
+    };
+
+    IndexRange(size_t rows, size_t cols) : rows(rows), cols(cols) {}
+    iterator begin() const { return iterator(0, cols); }
+    iterator end() const { return iterator(rows * cols, cols); }
+
+private:
+    size_t rows;
+    size_t cols;
+};
+
+// A matrix of arbitrary coefficients.
+// Blocks, rows, columns and transposes share the coefficients of the matrix they
+// are taken from and only copy them when they are modified.
 template <typename T, class Derived>
 class DynamicMatrix
 {
@@ -91,7 +142,7 @@ public:
     auto head(size_t n) const;
     auto tail(size_t n) const;
     auto segment(size_t i, size_t n) const;
-    std::vector<std::pair<size_t, size_t>> all_indices() const;
+    IndexRange all_indices() const;
 
     T &coeffRef(size_t row, size_t col = 0);
 
@@ -101,7 +152,22 @@ public:
     void resize(size_t rows, size_t cols);
 
 private:
-    std::vector<std::vector<T>> data_matrix;
+    size_t n_rows = 0;
+    size_t n_cols = 0;
+
+    // coefficient (row, col) is data_matrix[offset + row * row_stride + col * col_stride]
+    std::shared_ptr<std::vector<T>> data_matrix;
+    size_t offset = 0;
+    size_t row_stride = 1;
+    size_t col_stride = 0;
+    // the storage of a view that was its only owner before the first modification,
+    // so that references returned by coeff() stay valid until the next resize
+    std::shared_ptr<std::vector<T>> previous_data_matrix;
+
+    size_t index(size_t row, size_t col) const;
+    bool ownsStorage() const;
+    Derived view(size_t offset, size_t rows, size_t cols,
+                 size_t row_stride, size_t col_stride) const;
 };
 
 template <typename T, class Derived>
@@ -118,7 +184,13 @@ DynamicMatrix<T, Derived>::DynamicMatrix(size_t rows, size_t cols)
 
 template <typename T, class Derived>
 DynamicMatrix<T, Derived>::DynamicMatrix(const std::vector<std::vector<T>> &matrix)
-    : data_matrix(matrix) {}
+{
+    resize(matrix.size(), matrix.empty() ? 0 : matrix.front().size());
+    for (auto [row, col] : all_indices())
+    {
+        coeffRef(row, col) = matrix[row].at(col);
+    }
+}
 
 template <typename T, class Derived>
 bool DynamicMatrix<T, Derived>::empty() const
@@ -129,20 +201,13 @@ bool DynamicMatrix<T, Derived>::empty() const
 template <typename T, class Derived>
 size_t DynamicMatrix<T, Derived>::rows() const
 {
-    return data_matrix.size();
+    return n_rows;
 }
 
 template <typename T, class Derived>
 size_t DynamicMatrix<T, Derived>::cols() const
 {
-    if (rows() > 0)
-    {
-        return data_matrix.front().size();
-    }
-    else
-    {
-        return 0;
-    }
+    return n_cols;
 }
 
 template <typename T, class Derived>
@@ -161,7 +226,13 @@ template <typename T, class Derived>
 std::vector<T> DynamicMatrix<T, Derived>::rowElements(size_t index) const
 {
     assert(index < rows());
-    return data_matrix.at(index);
+    std::vector<T> row;
+    row.reserve(cols());
+    for (size_t col = 0; col < cols(); col++)
+    {
+        row.push_back(coeff(index, col));
+    }
+    return row;
 }
 
 template <typename T, class Derived>
@@ -169,9 +240,10 @@ std::vector<T> DynamicMatrix<T, Derived>::colElements(size_t index) const
 {
     assert(index < cols());
     std::vector<T> column;
-    for (const auto &row : data_matrix)
+    column.reserve(rows());
+    for (size_t row = 0; row < rows(); row++)
     {
-        column.push_back(row.at(index));
+        column.push_back(coeff(row, index));
     }
     return column;
 }
@@ -186,55 +258,30 @@ template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::operator()(size_t row, size_t col) const
 {
     assert(row < rows() and col < cols());
-    Derived result(1, 1);
-    result.coeffRef(0, 0) = coeff(row, col);
-    return result;
+    return view(index(row, col), 1, 1, 1, 1);
 }
 
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::row(size_t index) const
 {
-    assert(index < rows());
-
-    Derived result(1, cols());
-
-    for (size_t col = 0; col < cols(); col++)
-    {
-        result.coeffRef(0, col) = coeff(index, col);
-    }
-
-    return result;
+    return block(index, 0, 1, cols());
 }
 
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::col(size_t index) const
 {
-    assert(index < cols());
-
-    Derived result(rows(), 1);
-
-    for (size_t row = 0; row < rows(); row++)
-    {
-        result.coeffRef(row, 0) = coeff(row, index);
-    }
-
-    return result;
+    return block(0, index, rows(), 1);
 }
 
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::block(size_t start_row, size_t start_col,
                                       size_t n_rows, size_t n_cols) const
 {
-    assert((start_row + n_rows - 1) < rows() and
-           (start_col + n_cols - 1) < cols());
-
-    Derived result(n_rows, n_cols);
+    assert(start_row + n_rows <= rows() and
+           start_col + n_cols <= cols());
 
-    for (auto [row, col] : result.all_indices())
-    {
-        result.coeffRef(row, col) = coeff(start_row + row, start_col + col);
-    }
-    return result;
+    return view(offset + start_row * row_stride + start_col * col_stride,
+                n_rows, n_cols, row_stride, col_stride);
 }
 
 template <typename T, class Derived>
@@ -246,19 +293,19 @@ auto DynamicMatrix<T, Derived>::topLeftCorner(size_t n_rows, size_t n_cols) cons
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::bottomLeftCorner(size_t n_rows, size_t n_cols) const
 {
-    return block(rows() - n_rows - 1, 0, n_rows, n_cols);
+    return block(rows() - n_rows, 0, n_rows, n_cols);
 }
 
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::topRightCorner(size_t n_rows, size_t n_cols) const
 {
-    return block(0, cols() - n_cols - 1, n_rows, n_cols);
+    return block(0, cols() - n_cols, n_rows, n_cols);
 }
 
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::bottomRightCorner(size_t n_rows, size_t n_cols) const
 {
-    return block(rows() - n_rows - 1, cols() - n_cols - 1, n_rows, n_cols);
+    return block(rows() - n_rows, cols() - n_cols, n_rows, n_cols);
 }
 
 template <typename T, class Derived>
@@ -270,7 +317,7 @@ auto DynamicMatrix<T, Derived>::topRows(size_t n_rows) const
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::bottomRows(size_t n_rows) const
 {
-    return block(rows() - n_rows - 1, 0, n_rows, cols());
+    return block(rows() - n_rows, 0, n_rows, cols());
 }
 
 template <typename T, class Derived>
@@ -282,7 +329,7 @@ auto DynamicMatrix<T, Derived>::leftCols(size_t n_cols) const
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::rightCols(size_t n_cols) const
 {
-    return block(0, cols() - n_cols - 1, rows(), n_cols);
+    return block(0, cols() - n_cols, rows(), n_cols);
 }
 
 template <typename T, class Derived>
@@ -296,7 +343,7 @@ template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::tail(size_t n) const
 {
     assert(cols() == 1);
-    return block(rows() - n - 1, 0, n, 1);
+    return block(rows() - n, 0, n, 1);
 }
 
 template <typename T, class Derived>
@@ -309,54 +356,118 @@ auto DynamicMatrix<T, Derived>::segment(size_t i, size_t n) const
 template <typename T, class Derived>
 auto DynamicMatrix<T, Derived>::transpose() const
 {
-    Derived result(cols(), rows());
-
-    for (auto [row, col] : all_indices())
-    {
-        result.coeffRef(col, row) = coeff(row, col);
-    }
-
-    return result;
+    return view(offset, cols(), rows(), col_stride, row_stride);
 }
 
 template <typename T, class Derived>
 const T &DynamicMatrix<T, Derived>::coeff(size_t row, size_t col) const
 {
     assert(row < rows() and col < cols());
-    return data_matrix[row][col];
+    return (*data_matrix)[index(row, col)];
 }
 
+// copies shared or strided coefficients before the first modification
 template <typename T, class Derived>
 T &DynamicMatrix<T, Derived>::coeffRef(size_t row, size_t col)
 {
     assert(row < rows() and col < cols());
-    return data_matrix[row][col];
+    if (not ownsStorage())
+    {
+        // the extra owner makes resize() copy the coefficients instead of moving them
+        std::shared_ptr<std::vector<T>> previous = data_matrix;
+        resize(rows(), cols());
+        if (previous.use_count() == 1)
+        {
+            previous_data_matrix = std::move(previous);
+        }
+    }
+    return (*data_matrix)[col * n_rows + row];
 }
 
+// keeps the coefficients that are inside both the old and the new shape
 template <typename T, class Derived>
 void DynamicMatrix<T, Derived>::resize(size_t rows, size_t cols)
 {
-    data_matrix.resize(rows);
-    for (auto &row : data_matrix)
+    if (rows == 0)
+    {
+        cols = 0;
+    }
+    previous_data_matrix.reset();
+
+    if (ownsStorage() and (rows == n_rows or n_cols == 0))
+    {
+        // the existing columns stay in place
+        data_matrix->resize(rows * cols);
+    }
+    else if (rows * cols == 0)
+    {
+        data_matrix.reset();
+    }
+    else
     {
-        row.resize(cols);
+        auto resized = std::make_shared<std::vector<T>>(rows * cols);
+        const bool unique = data_matrix.use_count() == 1;
+        for (size_t col = 0; col < std::min(cols, n_cols); col++)
+        {
+            for (size_t row = 0; row < std::min(rows, n_rows); row++)
+            {
+                T &element = (*data_matrix)[index(row, col)];
+                if (unique)
+                {
+                    (*resized)[col * rows + row] = std::move(element);
+                }
+                else
+                {
+                    (*resized)[col * rows + row] = element;
+                }
+            }
+        }
+        data_matrix = std::move(resized);
     }
+    n_rows = rows;
+    n_cols = cols;
+    offset = 0;
+    row_stride = 1;
+    col_stride = rows;
 }
 
 template <typename T, class Derived>
-std::vector<std::pair<size_t, size_t>> DynamicMatrix<T, Derived>::all_indices() const
+IndexRange DynamicMatrix<T, Derived>::all_indices() const
 {
-    std::vector<std::pair<size_t, size_t>> indices;
+    return IndexRange(rows(), cols());
+}
 
-    for (size_t row = 0; row < rows(); row++)
+template <typename T, class Derived>
+size_t DynamicMatrix<T, Derived>::index(size_t row, size_t col) const
+{
+    return offset + row * row_stride + col * col_stride;
+}
+
+// true if the coefficients are not shared and stored in column major order
+template <typename T, class Derived>
+bool DynamicMatrix<T, Derived>::ownsStorage() const
+{
+    return data_matrix.use_count() == 1 and offset == 0 and row_stride == 1 and
+           col_stride == n_rows and data_matrix->size() == size();
+}
+
+template <typename T, class Derived>
+Derived DynamicMatrix<T, Derived>::view(size_t offset, size_t rows, size_t cols,
+                                        size_t row_stride, size_t col_stride) const
+{
+    Derived result(0, 0);
+    DynamicMatrix &matrix = result;
+    if (rows == 0 or cols == 0)
     {
-        for (size_t col = 0; col < cols(); col++)
-        {
-            indices.emplace_back(row, col);
-        }
+        return result;
     }
-
-    return indices;
+    matrix.data_matrix = data_matrix;
+    matrix.n_rows = rows;
+    matrix.n_cols = cols;
+    matrix.offset = offset;
+    matrix.row_stride = row_stride;
+    matrix.col_stride = col_stride;
+    return result;
 }
 
-} // namespace op
\ No newline at end of file
+} // namespace op
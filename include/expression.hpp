@@ -2,6 +2,7 @@
 
 #include "parameter.hpp"
 #include "variable.hpp"
+#include "expressionArena.hpp"
 
 #include <optional>
 
@@ -23,7 +24,7 @@ struct AffineTerm
     operator AffineSum() const;
 
     ParameterSource parameter;
-    std::optional<VariableSource> variable; // a missing Variable represents a constant 1.0
+    std::optional<size_t> variable; // index in the solution vector x, a missing variable represents a constant 1.0
     friend std::ostream &operator<<(std::ostream &os, const AffineTerm &term);
     double evaluate(const std::vector<double> &soln_values) const;
     AffineTerm operator*(const ParameterSource &parameter) const;
@@ -32,22 +33,41 @@ struct AffineTerm
 AffineTerm operator*(const ParameterSource &parameter, const VariableSource &variable);
 
 // A term like (p_1*x_1 + p_2*x_2 + ... + b)
+//
+// The linear terms are stored as parallel arrays, so that scans over
+// the variables only read a dense array of indices.
+// New and copied sums allocate from the resource of the current ArenaScope.
 struct AffineSum
 {
-    AffineSum() = default;
+    AffineSum();
     explicit AffineSum(const ParameterSource &parameter);
     explicit AffineSum(const VariableSource &variable);
     explicit AffineSum(const AffineTerm &term);
-
-    std::vector<AffineTerm> terms;
+    AffineSum(const AffineSum &other);
+    AffineSum(AffineSum &&other) = default;
+    AffineSum &operator=(const AffineSum &other) = default;
+    AffineSum &operator=(AffineSum &&other) = default;
+
+    std::pmr::vector<size_t> variables;             // indices in the solution vector x
+    std::pmr::vector<ParameterSource> coefficients; // the factor of each variable
+    std::pmr::vector<ParameterSource> constants;
+    void addTerm(const ParameterSource &parameter, size_t variable);
+    void reserve(size_t n_terms);
     friend std::ostream &operator<<(std::ostream &os, const AffineSum &expression);
     double evaluate(const std::vector<double> &soln_values) const;
     AffineSum &operator+=(const AffineSum &other);
+    AffineSum &operator+=(AffineSum &&other);
     AffineSum operator+(const AffineSum &other) const;
     AffineSum operator*(const ParameterSource &parameter) const;
+    AffineSum &operator*=(const ParameterSource &parameter);
     AffineSum operator-() const;
     size_t clean();
+    // Adds the coefficients of repeated variables to their first term.
+    // positions has to contain a zero for every variable and is restored afterwards.
+    size_t merge_variables(std::vector<size_t> &positions);
     bool is_constant() const;
+    // bytes of the term arrays
+    size_t allocated_bytes() const;
 };
 
 } // namespace internal
@@ -62,12 +82,16 @@ public:
     explicit Affine(const internal::AffineSum &expression);
     friend std::ostream &operator<<(std::ostream &os, const Affine &expression);
     Affine &operator+=(const Affine &other);
-    Affine operator-() const;
+    Affine operator-() const &;
+    Affine operator-() &&;
 };
-Affine operator+(const Affine &lhs, const Affine &rhs);
+// Temporaries passed by value are reused for the result,
+// so a chain like A * x + b - c builds only one matrix.
+Affine operator+(Affine lhs, const Affine &rhs);
 Affine operator*(const Parameter &parameter, const Variable &variable);
 Affine operator*(const Variable &variable, const Parameter &parameter);
-Affine operator*(const Parameter &parameter, const Affine &affine);
+Affine operator*(const Parameter &parameter, Affine affine);
+Affine operator*(Affine affine, const Parameter &parameter);
 
 namespace internal
 {
@@ -76,7 +100,7 @@ namespace internal
 struct Norm2Term
 {
     Norm2Term() = default;
-    explicit Norm2Term(const Affine &affine);
+    explicit Norm2Term(Affine affine);
     std::vector<internal::AffineSum> arguments;
     friend std::ostream &operator<<(std::ostream &os, const Norm2Term &norm2);
     double evaluate(const std::vector<double> &soln_values) const;
@@ -90,11 +114,14 @@ Affine sum(const Affine &affine, size_t axis);
 class SOCLhs : public DynamicMatrix<std::pair<internal::Norm2Term, internal::AffineSum>, SOCLhs>
 {
 public:
-    SOCLhs operator+(const Affine &affine) const;
-    SOCLhs &operator+=(const Affine &affine);
+    SOCLhs operator+(Affine affine) const &;
+    SOCLhs operator+(Affine affine) &&;
+    SOCLhs &operator+=(Affine affine);
 };
 
-SOCLhs norm2(const Affine &affine);
-SOCLhs norm2(const Affine &affine, size_t axis);
+// The expressions are taken by value so that the coefficients of temporaries
+// are moved into the norm instead of being copied.
+SOCLhs norm2(Affine affine);
+SOCLhs norm2(Affine affine, size_t axis);
 
 } // namespace op
\ No newline at end of file
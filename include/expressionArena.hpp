@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory_resource>
+
+namespace op
+{
+
+// Makes the expressions that are built on this thread allocate their terms
+// from the given memory resource until the scope ends, e.g.
+//
+//     op::SecondOrderConeProgram socp;
+//     op::ArenaScope scope(socp.getArena());
+//
+// The resource has to outlive all expressions that are built in the scope.
+class ArenaScope
+{
+public:
+    explicit ArenaScope(std::pmr::memory_resource *resource);
+    ~ArenaScope();
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    std::pmr::memory_resource *previous;
+};
+
+namespace internal
+{
+
+// The resource of the innermost ArenaScope on this thread or the default resource
+std::pmr::memory_resource *expressionResource();
+
+} // namespace internal
+
+} // namespace op
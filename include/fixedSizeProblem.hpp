@@ -0,0 +1,603 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include <Eigen/Dense>
+
+// A second order cone program whose shapes are known at compile time.
+//
+// The expressions keep their coefficients in std::array members and the problem
+// has a fixed capacity for variables, rows and terms, so building, canonicalizing
+// and updating it never allocates. Mismatching shapes fail with a static_assert.
+//
+// Only the basic operations are supported:
+//     FixedParameter * FixedVariable, sums and differences, scaling with a double,
+//     ==, >=, <= and norm2(vector) <= scalar.
+// The coefficients of a parameter are constants or pointers to doubles that are
+// read on every solve, e.g. the entries of an Eigen matrix with the same static shape.
+
+namespace op
+{
+
+template <size_t Rows, size_t Cols, size_t MaxTerms>
+class FixedAffine;
+
+namespace internal
+{
+
+// factor * *pointer, or only factor if there is no pointer,
+// multiplied with a variable or a constant without variable
+struct FixedTerm
+{
+    static constexpr size_t no_variable = std::numeric_limits<size_t>::max();
+
+    size_t variable = no_variable;
+    double factor = 0.;
+    const double *pointer = nullptr;
+
+    double value() const { return pointer ? factor * *pointer : factor; }
+    bool isZero() const { return pointer == nullptr and factor == 0.; }
+};
+
+template <size_t MaxTerms>
+struct FixedAffineSum
+{
+    std::array<FixedTerm, MaxTerms> terms;
+    size_t n_terms = 0;
+
+    void add(const FixedTerm &term)
+    {
+        assert(n_terms < MaxTerms);
+        terms[n_terms++] = term;
+    }
+};
+
+} // namespace internal
+
+// A scalar/vector/matrix of affine expressions with at most MaxTerms terms per coefficient
+template <size_t Rows, size_t Cols, size_t MaxTerms>
+class FixedAffine
+{
+public:
+    static constexpr size_t rows = Rows;
+    static constexpr size_t cols = Cols;
+    static constexpr size_t max_terms = MaxTerms;
+
+    internal::FixedAffineSum<MaxTerms> &coeffRef(size_t row, size_t col)
+    {
+        assert(row < Rows and col < Cols);
+        return coefficients[row * Cols + col];
+    }
+    const internal::FixedAffineSum<MaxTerms> &coeff(size_t row, size_t col) const
+    {
+        assert(row < Rows and col < Cols);
+        return coefficients[row * Cols + col];
+    }
+    const FixedAffine &toAffine() const { return *this; }
+
+private:
+    std::array<internal::FixedAffineSum<MaxTerms>, Rows * Cols> coefficients;
+};
+
+// A scalar/vector/matrix optimization variable.
+// Its coefficients have consecutive indices in row-major order, like a Variable.
+template <size_t Rows, size_t Cols = 1>
+class FixedVariable
+{
+public:
+    static constexpr size_t rows = Rows;
+    static constexpr size_t cols = Cols;
+    static constexpr size_t max_terms = 1;
+
+    explicit FixedVariable(size_t first_index) : first_index(first_index) {}
+
+    size_t index(size_t row, size_t col = 0) const
+    {
+        assert(row < Rows and col < Cols);
+        return first_index + row * Cols + col;
+    }
+    FixedAffine<Rows, Cols, 1> toAffine() const
+    {
+        FixedAffine<Rows, Cols, 1> affine;
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                affine.coeffRef(row, col).add({index(row, col), 1., nullptr});
+            }
+        }
+        return affine;
+    }
+
+private:
+    size_t first_index;
+};
+
+// A scalar/vector/matrix of constants or pointers to values
+template <size_t Rows, size_t Cols = 1>
+class FixedParameter
+{
+public:
+    static constexpr size_t rows = Rows;
+    static constexpr size_t cols = Cols;
+    static constexpr size_t max_terms = 1;
+
+    explicit FixedParameter(double constant)
+    {
+        static_assert(Rows == 1 and Cols == 1, "Only a scalar parameter can be created from a double.");
+        coefficients[0].factor = constant;
+    }
+    explicit FixedParameter(const double *pointer)
+    {
+        static_assert(Rows == 1 and Cols == 1, "Only a scalar parameter can be created from a double.");
+        coefficients[0] = {internal::FixedTerm::no_variable, 1., pointer};
+    }
+    explicit FixedParameter(const Eigen::Matrix<double, Rows, Cols> &constants)
+    {
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                coeffRef(row, col).factor = constants(row, col);
+            }
+        }
+    }
+    // The values are read on every solve, so the matrix has to outlive the problem.
+    explicit FixedParameter(const Eigen::Matrix<double, Rows, Cols> *matrix)
+    {
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                coeffRef(row, col) = {internal::FixedTerm::no_variable, 1., &(*matrix)(row, col)};
+            }
+        }
+    }
+
+    const internal::FixedTerm &coeff(size_t row, size_t col) const
+    {
+        assert(row < Rows and col < Cols);
+        return coefficients[row * Cols + col];
+    }
+    // constant zeros do not create terms
+    FixedAffine<Rows, Cols, 1> toAffine() const
+    {
+        FixedAffine<Rows, Cols, 1> affine;
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                if (not coeff(row, col).isZero())
+                {
+                    affine.coeffRef(row, col).add(coeff(row, col));
+                }
+            }
+        }
+        return affine;
+    }
+
+private:
+    internal::FixedTerm &coeffRef(size_t row, size_t col)
+    {
+        return coefficients[row * Cols + col];
+    }
+
+    std::array<internal::FixedTerm, Rows * Cols> coefficients;
+};
+
+// The left hand side of a cone constraint like norm2(A * x + b) <= c * x + d
+template <size_t Rows, size_t MaxTerms>
+struct FixedNorm2
+{
+    FixedAffine<Rows, 1, MaxTerms> arguments;
+};
+
+namespace internal
+{
+
+template <typename T>
+struct IsFixedExpression : std::false_type
+{
+};
+template <size_t Rows, size_t Cols, size_t MaxTerms>
+struct IsFixedExpression<FixedAffine<Rows, Cols, MaxTerms>> : std::true_type
+{
+};
+template <size_t Rows, size_t Cols>
+struct IsFixedExpression<FixedVariable<Rows, Cols>> : std::true_type
+{
+};
+template <size_t Rows, size_t Cols>
+struct IsFixedExpression<FixedParameter<Rows, Cols>> : std::true_type
+{
+};
+
+template <typename... Ts>
+using EnableIfFixed = std::enable_if_t<(IsFixedExpression<Ts>::value and ...)>;
+
+template <typename Lhs, typename Rhs>
+constexpr void checkSameShape()
+{
+    static_assert(Lhs::rows == Rhs::rows and Lhs::cols == Rhs::cols,
+                  "The expressions must have the same shape.");
+}
+
+template <size_t Rows, size_t Cols, size_t N, size_t M>
+FixedAffine<Rows, Cols, N + M> fixedSum(const FixedAffine<Rows, Cols, N> &lhs,
+                                        const FixedAffine<Rows, Cols, M> &rhs,
+                                        double rhs_factor)
+{
+    FixedAffine<Rows, Cols, N + M> result;
+    for (size_t row = 0; row < Rows; row++)
+    {
+        for (size_t col = 0; col < Cols; col++)
+        {
+            FixedAffineSum<N + M> &sum = result.coeffRef(row, col);
+            const FixedAffineSum<N> &lhs_sum = lhs.coeff(row, col);
+            const FixedAffineSum<M> &rhs_sum = rhs.coeff(row, col);
+            for (size_t i = 0; i < lhs_sum.n_terms; i++)
+            {
+                sum.add(lhs_sum.terms[i]);
+            }
+            for (size_t i = 0; i < rhs_sum.n_terms; i++)
+            {
+                FixedTerm term = rhs_sum.terms[i];
+                term.factor *= rhs_factor;
+                sum.add(term);
+            }
+        }
+    }
+    return result;
+}
+
+template <size_t Rows, size_t Cols, size_t N>
+FixedAffine<Rows, Cols, N> fixedScale(FixedAffine<Rows, Cols, N> affine, double factor)
+{
+    for (size_t row = 0; row < Rows; row++)
+    {
+        for (size_t col = 0; col < Cols; col++)
+        {
+            FixedAffineSum<N> &sum = affine.coeffRef(row, col);
+            for (size_t i = 0; i < sum.n_terms; i++)
+            {
+                sum.terms[i].factor *= factor;
+            }
+        }
+    }
+    return affine;
+}
+
+// the same constant in every coefficient
+template <size_t Rows, size_t Cols>
+FixedAffine<Rows, Cols, 1> fixedConstant(double constant)
+{
+    FixedAffine<Rows, Cols, 1> affine;
+    if (constant != 0.)
+    {
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                affine.coeffRef(row, col).add({FixedTerm::no_variable, constant, nullptr});
+            }
+        }
+    }
+    return affine;
+}
+
+// represents a constraint like
+//     p_1*x_1 + p_2*x_2 + ... + b == 0
+// for every coefficient
+template <size_t Rows, size_t Cols, size_t MaxTerms>
+struct FixedEqualityConstraint
+{
+    FixedAffine<Rows, Cols, MaxTerms> affine;
+};
+
+// represents a constraint like
+//     p_1*x_1 + p_2*x_2 + ... + b >= 0
+// for every coefficient
+template <size_t Rows, size_t Cols, size_t MaxTerms>
+struct FixedPositiveConstraint
+{
+    FixedAffine<Rows, Cols, MaxTerms> affine;
+};
+
+// represents a constraint like
+//      norm2([p_1*x_1 + p_2*x_2 + ... + b_1,   p_3*x_3 + p_4*x_4 + ... + b_2 ])
+//        <= p_5*x_5 + p_6*x_6 + ... + b_3
+template <size_t Rows, size_t NormTerms, size_t MaxTerms>
+struct FixedSecondOrderConeConstraint
+{
+    FixedNorm2<Rows, NormTerms> norm2;
+    FixedAffine<1, 1, MaxTerms> affine;
+};
+
+// A row of a constraint or a minimization term with the range of its terms in the problem
+struct FixedRow
+{
+    enum class Type
+    {
+        Equality,
+        Positive,
+        Cone,
+        Cost,
+    };
+    Type type = Type::Cost;
+    size_t first_term = 0;
+    size_t n_terms = 0;
+    // the dimension of the cone in its first row, the affine right hand side, and 0 in its arguments
+    size_t cone_size = 0;
+};
+
+} // namespace internal
+
+template <typename Lhs, typename Rhs, typename = internal::EnableIfFixed<Lhs, Rhs>>
+auto operator+(const Lhs &lhs, const Rhs &rhs)
+{
+    internal::checkSameShape<Lhs, Rhs>();
+    return internal::fixedSum(lhs.toAffine(), rhs.toAffine(), 1.);
+}
+
+template <typename Lhs, typename Rhs, typename = internal::EnableIfFixed<Lhs, Rhs>>
+auto operator-(const Lhs &lhs, const Rhs &rhs)
+{
+    internal::checkSameShape<Lhs, Rhs>();
+    return internal::fixedSum(lhs.toAffine(), rhs.toAffine(), -1.);
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator-(const Expression &expression)
+{
+    return internal::fixedScale(expression.toAffine(), -1.);
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator*(double factor, const Expression &expression)
+{
+    return internal::fixedScale(expression.toAffine(), factor);
+}
+
+// A matrix product, or the scaling of the variable if the parameter is a scalar.
+// Constant zeros of the parameter do not create terms.
+template <size_t Rows, size_t Inner, size_t VariableRows, size_t Cols>
+auto operator*(const FixedParameter<Rows, Inner> &parameter, const FixedVariable<VariableRows, Cols> &variable)
+{
+    if constexpr (Rows == 1 and Inner == 1)
+    {
+        FixedAffine<VariableRows, Cols, 1> affine;
+        const internal::FixedTerm &factor = parameter.coeff(0, 0);
+        if (not factor.isZero())
+        {
+            for (size_t row = 0; row < VariableRows; row++)
+            {
+                for (size_t col = 0; col < Cols; col++)
+                {
+                    affine.coeffRef(row, col).add({variable.index(row, col), factor.factor, factor.pointer});
+                }
+            }
+        }
+        return affine;
+    }
+    else
+    {
+        static_assert(Inner == VariableRows, "The inner dimensions of the product must match.");
+        FixedAffine<Rows, Cols, Inner> affine;
+        for (size_t row = 0; row < Rows; row++)
+        {
+            for (size_t col = 0; col < Cols; col++)
+            {
+                for (size_t k = 0; k < Inner; k++)
+                {
+                    const internal::FixedTerm &factor = parameter.coeff(row, k);
+                    if (not factor.isZero())
+                    {
+                        affine.coeffRef(row, col).add({variable.index(k, col), factor.factor, factor.pointer});
+                    }
+                }
+            }
+        }
+        return affine;
+    }
+}
+
+template <typename Lhs, typename Rhs, typename = internal::EnableIfFixed<Lhs, Rhs>>
+auto operator==(const Lhs &lhs, const Rhs &rhs)
+{
+    // rhs - lhs like the dynamic constraints, so that both give the same standard form
+    auto difference = rhs - lhs;
+    return internal::FixedEqualityConstraint<Lhs::rows, Lhs::cols, decltype(difference)::max_terms>{difference};
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator==(const Expression &expression, double constant)
+{
+    return expression == internal::fixedConstant<Expression::rows, Expression::cols>(constant);
+}
+
+template <typename Lhs, typename Rhs, typename = internal::EnableIfFixed<Lhs, Rhs>>
+auto operator>=(const Lhs &lhs, const Rhs &rhs)
+{
+    auto difference = lhs - rhs;
+    return internal::FixedPositiveConstraint<Lhs::rows, Lhs::cols, decltype(difference)::max_terms>{difference};
+}
+
+template <typename Lhs, typename Rhs, typename = internal::EnableIfFixed<Lhs, Rhs>>
+auto operator<=(const Lhs &lhs, const Rhs &rhs)
+{
+    return rhs >= lhs;
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator>=(const Expression &expression, double constant)
+{
+    return expression >= internal::fixedConstant<Expression::rows, Expression::cols>(constant);
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator<=(const Expression &expression, double constant)
+{
+    return internal::fixedConstant<Expression::rows, Expression::cols>(constant) >= expression;
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator<=(double constant, const Expression &expression)
+{
+    return expression >= constant;
+}
+
+template <typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto norm2(const Expression &expression)
+{
+    static_assert(Expression::cols == 1, "The norm can only be taken of a column vector.");
+    auto arguments = expression.toAffine();
+    return FixedNorm2<Expression::rows, decltype(arguments)::max_terms>{arguments};
+}
+
+template <size_t Rows, size_t NormTerms, typename Expression, typename = internal::EnableIfFixed<Expression>>
+auto operator<=(const FixedNorm2<Rows, NormTerms> &norm2, const Expression &expression)
+{
+    static_assert(Expression::rows == 1 and Expression::cols == 1, "The right hand side of a cone must be a scalar.");
+    auto affine = expression.toAffine();
+    return internal::FixedSecondOrderConeConstraint<Rows, NormTerms, decltype(affine)::max_terms>{norm2, affine};
+}
+
+template <size_t Rows, size_t NormTerms>
+auto operator<=(const FixedNorm2<Rows, NormTerms> &norm2, double constant)
+{
+    return norm2 <= internal::fixedConstant<1, 1>(constant);
+}
+
+// A problem with room for MaxVariables variables, MaxRows rows and MaxTerms terms.
+// Every coefficient of a constraint and every minimization term takes one row,
+// a cone takes one row for its right hand side and one for each argument.
+// Exceeding the capacity throws a std::runtime_error.
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+struct FixedSecondOrderConeProgram
+{
+    std::array<internal::FixedRow, MaxRows> rows;
+    std::array<internal::FixedTerm, MaxTerms> terms;
+    std::array<double, MaxVariables> solution_vector{};
+    size_t n_variables = 0;
+    size_t n_rows = 0;
+    size_t n_terms = 0;
+
+    template <size_t Rows, size_t Cols = 1>
+    FixedVariable<Rows, Cols> createVariable();
+
+    template <size_t Rows, size_t Cols, size_t N>
+    void addConstraint(const internal::FixedEqualityConstraint<Rows, Cols, N> &constraint);
+    template <size_t Rows, size_t Cols, size_t N>
+    void addConstraint(const internal::FixedPositiveConstraint<Rows, Cols, N> &constraint);
+    template <size_t Rows, size_t NormTerms, size_t N>
+    void addConstraint(const internal::FixedSecondOrderConeConstraint<Rows, NormTerms, N> &constraint);
+
+    template <typename Expression>
+    void addMinimizationTerm(const Expression &expression);
+
+    template <size_t Rows, size_t Cols>
+    void readSolution(const FixedVariable<Rows, Cols> &variable, Eigen::Matrix<double, int(Rows), int(Cols)> &solution) const;
+
+private:
+    template <size_t N>
+    void addRow(internal::FixedRow::Type type, const internal::FixedAffineSum<N> &sum, size_t cone_size = 0);
+};
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t Rows, size_t Cols>
+FixedVariable<Rows, Cols> FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::createVariable()
+{
+    if (n_variables + Rows * Cols > MaxVariables)
+    {
+        throw std::runtime_error("The problem has no room for another variable.");
+    }
+    FixedVariable<Rows, Cols> variable(n_variables);
+    n_variables += Rows * Cols;
+    return variable;
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t Rows, size_t Cols, size_t N>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::addConstraint(const internal::FixedEqualityConstraint<Rows, Cols, N> &constraint)
+{
+    for (size_t row = 0; row < Rows; row++)
+    {
+        for (size_t col = 0; col < Cols; col++)
+        {
+            addRow(internal::FixedRow::Type::Equality, constraint.affine.coeff(row, col));
+        }
+    }
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t Rows, size_t Cols, size_t N>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::addConstraint(const internal::FixedPositiveConstraint<Rows, Cols, N> &constraint)
+{
+    for (size_t row = 0; row < Rows; row++)
+    {
+        for (size_t col = 0; col < Cols; col++)
+        {
+            addRow(internal::FixedRow::Type::Positive, constraint.affine.coeff(row, col));
+        }
+    }
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t Rows, size_t NormTerms, size_t N>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::addConstraint(const internal::FixedSecondOrderConeConstraint<Rows, NormTerms, N> &constraint)
+{
+    addRow(internal::FixedRow::Type::Cone, constraint.affine.coeff(0, 0), Rows + 1);
+    for (size_t row = 0; row < Rows; row++)
+    {
+        addRow(internal::FixedRow::Type::Cone, constraint.norm2.arguments.coeff(row, 0));
+    }
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <typename Expression>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::addMinimizationTerm(const Expression &expression)
+{
+    static_assert(Expression::rows == 1 and Expression::cols == 1, "A minimization term must be a scalar.");
+    addRow(internal::FixedRow::Type::Cost, expression.toAffine().coeff(0, 0));
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t Rows, size_t Cols>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::readSolution(const FixedVariable<Rows, Cols> &variable,
+                                                                              Eigen::Matrix<double, int(Rows), int(Cols)> &solution) const
+{
+    for (size_t row = 0; row < Rows; row++)
+    {
+        for (size_t col = 0; col < Cols; col++)
+        {
+            solution(row, col) = solution_vector[variable.index(row, col)];
+        }
+    }
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+template <size_t N>
+void FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms>::addRow(internal::FixedRow::Type type,
+                                                                        const internal::FixedAffineSum<N> &sum,
+                                                                        size_t cone_size)
+{
+    if (n_rows == MaxRows)
+    {
+        throw std::runtime_error("The problem has no room for another row.");
+    }
+    if (n_terms + sum.n_terms > MaxTerms)
+    {
+        throw std::runtime_error("The problem has no room for the terms of another row.");
+    }
+    rows[n_rows++] = {type, n_terms, sum.n_terms, cone_size};
+    for (size_t i = 0; i < sum.n_terms; i++)
+    {
+        terms[n_terms++] = sum.terms[i];
+    }
+}
+
+} // namespace op
@@ -2,8 +2,9 @@
 
 #include "constraint.hpp"
 
-#include <map>
+#include <unordered_map>
 #include <vector>
+#include <memory>
 
 namespace op
 {
@@ -11,39 +12,68 @@ namespace op
 class GenericOptimizationProblem
 {
 public:
+    // The arena of the problem requests its memory from upstream
+    explicit GenericOptimizationProblem(std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+    // A monotonic arena that is released in one piece together with the problem.
+    // Expressions built inside an ArenaScope with this arena must not outlive the problem.
+    std::pmr::memory_resource *getArena() const;
+
     Variable createVariable(const std::string &name,
                             size_t rows = 1, size_t cols = 1);
 
+    // Variables are numbered in the order they were created.
+    // A handle avoids the lookup by name when a solution is read repeatedly.
+    size_t getVariableHandle(const std::string &name) const;
+    size_t getNumVariableHandles() const;
+    const std::string &getVariableName(size_t handle) const;
+
     Variable getVariable(const std::string &name) const;
+    const Variable &getVariable(size_t handle) const;
 
     size_t getNumVariables() const;
 
     void readSolution(const std::string &name,
                       double &solution) const;
+    void readSolution(size_t handle,
+                      double &solution) const;
 
     template <typename Derived>
     void readSolution(const std::string &name,
                       Eigen::PlainObjectBase<Derived> &solution) const;
+    template <typename Derived>
+    void readSolution(size_t handle,
+                      Eigen::PlainObjectBase<Derived> &solution) const;
 
     std::vector<double> solution_vector;
 
 protected:
-    std::map<std::string, Variable> variables;
+    // declared first so that it is released after the expressions of derived problems
+    std::shared_ptr<std::pmr::monotonic_buffer_resource> arena;
+    // the arenas of the merged builders
+    std::vector<std::shared_ptr<std::pmr::monotonic_buffer_resource>> builder_arenas;
+
+    std::vector<Variable> variables;
+    std::vector<std::string> variable_names;
+    std::unordered_map<std::string, size_t> variable_handles;
 };
 
 template <typename Derived>
 void GenericOptimizationProblem::readSolution(const std::string &name,
                                               Eigen::PlainObjectBase<Derived> &solution) const
 {
-    const Variable &variable = variables.at(name);
-    solution.resize(variable.rows(), variable.cols());
-    for (size_t row = 0; row < variable.rows(); row++)
-    {
-        for (size_t col = 0; col < variable.cols(); col++)
-        {
-            solution(row, col) = solution_vector[variable.coeff(row, col).getProblemIndex()];
-        }
-    }
+    readSolution(getVariableHandle(name), solution);
+}
+
+template <typename Derived>
+void GenericOptimizationProblem::readSolution(size_t handle,
+                                              Eigen::PlainObjectBase<Derived> &solution) const
+{
+    const Variable &variable = variables.at(handle);
+    // the coefficients of a variable are consecutive in row major order
+    using RowMajorMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    solution = Eigen::Map<const RowMajorMatrix>(&solution_vector[variable.coeff(0).getProblemIndex()],
+                                                variable.rows(), variable.cols());
 }
 
-} // namespace op
\ No newline at end of file
+} // namespace op
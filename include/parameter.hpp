@@ -5,21 +5,61 @@
 #include <utility>
 #include <variant>
 #include <memory>
+#include <map>
+#include <array>
+#include <atomic>
+#include <cassert>
 
 #include "dynamicMatrix.hpp"
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 namespace op
 {
 
 class Affine;
+class ParameterBlock;
 
 namespace internal
 {
 
 struct AffineTerm;
 struct AffineSum;
+class ParameterSource;
+class ParameterTape;
+struct ParameterMatrix;
+
+// An arithmetic operation on parameters like (p_1 + p_2)
+// Sums and products are flat and can have any number of operands,
+// differences and quotients have exactly two.
+struct ParameterOperation
+{
+    enum class Type
+    {
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+    };
+    Type type;
+    std::vector<ParameterSource> operands;
+};
+
+// A coefficient of a ParameterBlock
+struct ParameterBlockElement
+{
+    ParameterBlock *block;
+    size_t index;
+};
+
+// A coefficient of a matrix valued parameter operation
+struct ParameterMatrixElement
+{
+    std::shared_ptr<const ParameterMatrix> matrix;
+    size_t row;
+    size_t col;
+};
 
 class ParameterSource
 {
@@ -28,10 +68,15 @@ public:
     explicit ParameterSource(const double const_value);
     explicit ParameterSource(double *value_ptr);
     explicit ParameterSource(const std::function<double()> &callback);
+    explicit ParameterSource(const ParameterMatrixElement &element);
+    explicit ParameterSource(const ParameterBlockElement &element);
     double get_value() const;
     bool is_constant() const;
     bool is_pointer() const;
     bool is_callback() const;
+    bool is_operation() const;
+    bool is_matrix_element() const;
+    bool is_block_element() const;
     bool is_zero() const;
     bool is_one() const;
 
@@ -39,18 +84,149 @@ public:
     ParameterSource operator-(const ParameterSource &other) const;
     ParameterSource operator*(const ParameterSource &other) const;
     ParameterSource operator/(const ParameterSource &other) const;
+    ParameterSource &operator+=(const ParameterSource &other);
+    ParameterSource &operator*=(const ParameterSource &other);
     operator AffineTerm() const;
     operator AffineSum() const;
 
+    const ParameterMatrixElement &get_matrix_element() const;
+
 private:
+    ParameterSource(ParameterOperation::Type type,
+                    const ParameterSource &lhs,
+                    const ParameterSource &rhs);
+    bool is_operation(ParameterOperation::Type type) const;
+    void appendOperand(ParameterSource operand);
+
     using source_variant_t = std::variant<double,
                                           const double *,
-                                          std::function<double()>>;
+                                          // shared so that copies of a callback are evaluated once
+                                          std::shared_ptr<const std::function<double()>>,
+                                          // immutable once shared, so that copies are cheap
+                                          std::shared_ptr<ParameterOperation>,
+                                          ParameterMatrixElement,
+                                          ParameterBlockElement>;
     source_variant_t source;
+
+    friend class ParameterTape;
+};
+
+// A matrix of parameters that is evaluated as a whole,
+// e.g. the product of two parameter matrices
+struct ParameterMatrix
+{
+    enum class Type
+    {
+        Elements, // the coefficients in column major order
+        Product,
+        Add,
+        Subtract,
+        CwiseProduct,
+        Scale,    // elements[0] * operands[0]
+        Callback, // filled by callback
+    };
+    Type type;
+    size_t rows;
+    size_t cols;
+    std::vector<ParameterSource> elements;
+    std::vector<std::shared_ptr<const ParameterMatrix>> operands;
+    std::function<void(Eigen::Ref<Eigen::MatrixXd>)> callback;
+    // coefficients that are zero for all values of the operands in column major order,
+    // empty if there are none
+    std::vector<bool> zeros;
+
+    // Runs the callback of a Callback matrix for every call outside of an EvaluationScope
+    double get_value(size_t row, size_t col) const;
+    Eigen::MatrixXd get_values() const;
+};
+
+// Runs every matrix callback at most once while the scope is alive on this thread,
+// so that reading the coefficients one by one, e.g. in AffineSum::evaluate(),
+// does not run a callback for each of them. Changes of the values inside the scope are not seen.
+class EvaluationScope
+{
+public:
+    EvaluationScope();
+    ~EvaluationScope();
+    EvaluationScope(const EvaluationScope &) = delete;
+    EvaluationScope &operator=(const EvaluationScope &) = delete;
+
+private:
+    EvaluationScope *previous;
+    std::map<const ParameterMatrix *, Eigen::MatrixXd> callback_values;
+
+    friend struct ParameterMatrix;
 };
 
 } // namespace internal
 
+// A matrix of parameter values with a version counter.
+//
+// The version has to be increased on every change of the values,
+// either by calling set() or by calling touch() after modifying values().
+// The solvers only update the coefficients that depend on blocks with a new version.
+// The shape of the block must not change after it has been used in a Parameter.
+//
+// While a solve is running, another thread can hand over new values with publish().
+// It never blocks and the solver takes the last complete set of published values
+// before it evaluates the parameters of the next solve.
+class ParameterBlock
+{
+public:
+    explicit ParameterBlock(size_t rows, size_t cols = 1);
+    template <typename Derived>
+    explicit ParameterBlock(const Eigen::DenseBase<Derived> &values);
+    ParameterBlock(const ParameterBlock &) = delete;
+    ParameterBlock &operator=(const ParameterBlock &) = delete;
+
+    template <typename Derived>
+    void set(const Eigen::DenseBase<Derived> &values);
+    void touch();
+
+    // Can be called by a single producer thread at any time.
+    template <typename Derived>
+    void publish(const Eigen::DenseBase<Derived> &values);
+    // Moves the last published values to values() if there are new ones.
+    // Called by the solvers on their own thread.
+    bool acquire();
+
+    Eigen::MatrixXd &values();
+    const Eigen::MatrixXd &values() const;
+    size_t version() const;
+
+private:
+    Eigen::MatrixXd block_values;
+    size_t block_version = 0;
+
+    // A triple buffer for publish(): the producer owns buffers[back_buffer],
+    // the consumer owns buffers[front_buffer] and the third one is exchanged
+    // through shared_buffer, together with a flag for new values.
+    static constexpr size_t new_values = 4;
+    std::array<Eigen::MatrixXd, 3> buffers;
+    size_t back_buffer = 0;
+    size_t front_buffer = 1;
+    std::atomic<size_t> shared_buffer{2};
+};
+
+template <typename Derived>
+ParameterBlock::ParameterBlock(const Eigen::DenseBase<Derived> &values)
+    : block_values(values) {}
+
+template <typename Derived>
+void ParameterBlock::set(const Eigen::DenseBase<Derived> &values)
+{
+    assert(values.rows() == block_values.rows() and values.cols() == block_values.cols());
+    block_values = values;
+    touch();
+}
+
+template <typename Derived>
+void ParameterBlock::publish(const Eigen::DenseBase<Derived> &values)
+{
+    buffers[back_buffer] = values;
+    back_buffer = shared_buffer.exchange(back_buffer | new_values, std::memory_order_acq_rel) & ~new_values;
+}
+
 class Parameter : public DynamicMatrix<internal::ParameterSource, Parameter>
 {
 public:
@@ -58,21 +234,35 @@ public:
     explicit Parameter(const double const_value);
     explicit Parameter(double *value_ptr);
     explicit Parameter(const std::function<double()> &callback);
+    // a matrix parameter whose values are all written by one call of the callback
+    Parameter(size_t rows, size_t cols,
+              const std::function<void(Eigen::Ref<Eigen::MatrixXd>)> &callback);
+    explicit Parameter(ParameterBlock *block);
 
     template <typename Derived>
     explicit Parameter(const Eigen::DenseBase<Derived> &matrix);
     template <typename Derived>
     explicit Parameter(Eigen::DenseBase<Derived> *matrix);
 
+    // Only the stored coefficients of a sparse matrix are parameters,
+    // all others are structural zeros that never create terms in expressions.
+    // A pointer parameter reads the stored values, so the sparsity pattern must not change.
+    template <int Options, typename StorageIndex>
+    explicit Parameter(const Eigen::SparseMatrix<double, Options, StorageIndex> &matrix);
+    template <int Options, typename StorageIndex>
+    explicit Parameter(Eigen::SparseMatrix<double, Options, StorageIndex> *matrix);
+
     Parameter operator+(const Parameter &other) const;
     Parameter operator-() const;
     Parameter operator-(const Parameter &other) const;
     Parameter operator*(const Parameter &other) const;
     Parameter operator/(const Parameter &other) const;
-    Affine cwiseProduct(const Affine &affine) const;
+    Parameter cwiseProduct(const Parameter &other) const;
+    Affine cwiseProduct(Affine affine) const;
     double get_value(const size_t row = 0,
                      const size_t col = 0) const;
     Eigen::MatrixXd get_values() const;
+    bool is_constant() const;
 
     operator Affine() const;
 };
@@ -103,4 +293,30 @@ Parameter::Parameter(Eigen::DenseBase<Derived> *matrix)
     }
 }
 
+template <int Options, typename StorageIndex>
+Parameter::Parameter(const Eigen::SparseMatrix<double, Options, StorageIndex> &matrix)
+{
+    resize(matrix.rows(), matrix.cols());
+    for (Eigen::Index outer = 0; outer < matrix.outerSize(); outer++)
+    {
+        for (typename Eigen::SparseMatrix<double, Options, StorageIndex>::InnerIterator it(matrix, outer); it; ++it)
+        {
+            coeffRef(it.row(), it.col()) = internal::ParameterSource(it.value());
+        }
+    }
+}
+
+template <int Options, typename StorageIndex>
+Parameter::Parameter(Eigen::SparseMatrix<double, Options, StorageIndex> *matrix)
+{
+    resize(matrix->rows(), matrix->cols());
+    for (Eigen::Index outer = 0; outer < matrix->outerSize(); outer++)
+    {
+        for (typename Eigen::SparseMatrix<double, Options, StorageIndex>::InnerIterator it(*matrix, outer); it; ++it)
+        {
+            coeffRef(it.row(), it.col()) = internal::ParameterSource(&it.valueRef());
+        }
+    }
+}
+
 } // namespace op
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "parameter.hpp"
+#include "threadPool.hpp"
+
+#include <vector>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <cstdint>
+#include <limits>
+
+namespace op
+{
+
+namespace internal
+{
+
+// A flat program that evaluates a list of parameters.
+//
+// The parameter expressions are lowered once into a register file and a
+// linear list of instructions so that repeated evaluations do not have to
+// walk the expression trees. Matrix operations are evaluated as a whole
+// with Eigen and store their results as a block of registers.
+// Common subexpressions, including copies of the same callback, are
+// lowered to a single register and evaluated once per update.
+//
+// Every register has a signature: the set of ParameterBlocks it depends on,
+// where pointers and callbacks count as a block that always changes.
+// The program is split into segments of equal signature so that an update
+// only has to run the segments whose blocks have a new version.
+//
+// Outputs that are only a pointer or block value times a constant are not
+// lowered. They are copied in runs of consecutive outputs whose values lie
+// at a constant stride in memory, e.g. the columns of a dense matrix.
+//
+// With a thread pool, large segments are evaluated in parallel in chunks of
+// chunk_size values. Every value is computed by the same operations no
+// matter which thread evaluates it, so the results are deterministic.
+class ParameterTape
+{
+public:
+    // Appends the given parameters multiplied by factor to the outputs
+    // and returns the offset of the first one.
+    size_t addOutputs(const std::vector<ParameterSource> &parameters,
+                      double factor = 1.);
+
+    // Number of output values
+    size_t size() const;
+
+    // Takes the published values of all parameter blocks,
+    // evaluates the outputs that are stale and writes them to output[0] ... output[size() - 1].
+    // The block versions are tracked for every output buffer, so that multiple buffers
+    // can be updated in turns. Returns the number of outputs that were written.
+    size_t update(double *output);
+
+    // Evaluates large segments on the given pool, nullptr evaluates on the calling thread.
+    // The pool has to outlive the tape or be reset before.
+    void setThreadPool(ThreadPool *pool);
+    // Ranges with fewer chunks are evaluated on the calling thread.
+    void setMinParallelChunks(size_t chunks);
+
+    // Marks all outputs as stale, e.g. to time a full evaluation.
+    void invalidate();
+
+    // Prepares the evaluation and releases the tables that are only needed to add outputs.
+    // No outputs can be added afterwards. Returns the number of bytes released.
+    size_t compact();
+
+    // values per chunk of parallel work, 32KiB of doubles
+    static constexpr size_t chunk_size = 4096;
+    // operands of products with at most this share of nonzeros are multiplied as sparse matrices
+    static constexpr double max_sparse_density = 0.5;
+
+private:
+    enum class Opcode
+    {
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        MatrixOperation, // lhs is the index of the matrix instruction
+    };
+
+    struct Instruction
+    {
+        Opcode opcode;
+        size_t result;
+        size_t lhs;
+        size_t rhs;
+        size_t signature;
+        // instructions of the same level in a segment do not depend on each other
+        size_t level;
+    };
+
+    struct MatrixOperand
+    {
+        size_t rows;
+        size_t cols;
+        // first register of a block in column major order
+        size_t block;
+        // or the registers of the single coefficients that are gathered in values
+        std::vector<size_t> registers;
+        Eigen::MatrixXd values;
+        // Column major indices of the coefficients that are not structural zeros, empty if dense.
+        // The gathered coefficients of a sparse operand only have registers at these indices.
+        std::vector<size_t> nonzeros;
+        // the values at the nonzeros, if the operand is multiplied as a sparse matrix
+        Eigen::SparseMatrix<double> sparse_values;
+    };
+
+    struct MatrixInstruction
+    {
+        ParameterMatrix::Type type;
+        size_t rows;
+        size_t cols;
+        size_t scalar;
+        std::vector<MatrixOperand> operands;
+        // the operand of a product that is multiplied as a sparse matrix, or no_operand
+        size_t sparse_operand;
+    };
+    static constexpr size_t no_operand = std::numeric_limits<size_t>::max();
+
+    struct PointerLoad
+    {
+        size_t result;
+        const double *pointer;
+        size_t signature;
+    };
+
+    // a scalar callback or a matrix callback that fills a block of registers
+    struct CallbackLoad
+    {
+        size_t result;
+        std::shared_ptr<const std::function<double()>> callback;
+        std::shared_ptr<const ParameterMatrix> matrix;
+        size_t signature;
+    };
+
+    struct Output
+    {
+        size_t index;
+        size_t source;
+        double factor;
+        size_t signature;
+    };
+
+    // An output that is a scaled pointer or block value
+    struct Copy
+    {
+        size_t index;
+        const double *pointer;
+        double factor;
+        size_t signature;
+    };
+
+    // output[index + i] = factor * pointer[i * stride] for i < count
+    struct CopyRun
+    {
+        size_t index;
+        const double *pointer;
+        ptrdiff_t stride;
+        size_t count;
+        double factor;
+        size_t signature;
+    };
+
+    // The instructions of one signature, stored as the end of its range in each list
+    struct Segment
+    {
+        size_t signature;
+        size_t pointer_loads_end;
+        size_t callback_loads_end;
+        size_t instructions_end;
+        size_t levels_end;
+        size_t outputs_end;
+        size_t copy_runs_end;
+        size_t copy_chunks_end;
+    };
+
+    static Opcode to_opcode(ParameterOperation::Type type);
+    size_t lower(const ParameterSource &parameter);
+    size_t lowerMatrix(const std::shared_ptr<const ParameterMatrix> &matrix);
+    MatrixOperand lowerMatrixOperand(const std::shared_ptr<const ParameterMatrix> &matrix,
+                                     size_t &signature);
+    static void chooseSparseOperand(MatrixInstruction &instruction);
+    size_t addRegister(double value, size_t signature);
+    size_t lowerOperation(Opcode opcode, size_t lhs, size_t rhs);
+    size_t loadPointer(const double *pointer, size_t signature);
+    bool resolveCopy(const ParameterSource &parameter, Copy &copy);
+
+    size_t addSignature(const std::vector<size_t> &blocks);
+    size_t mergeSignatures(size_t signature1, size_t signature2);
+    size_t getBlockSignature(ParameterBlock *block);
+
+    void finalize();
+    void computeLevels();
+    void evaluateInstructions(size_t begin, size_t end);
+    void evaluateMatrix(MatrixInstruction &instruction, size_t result);
+    void gatherSparse(MatrixOperand &operand);
+    // templates so that the closures of an update are not copied into std::functions on the heap
+    template <typename Chunk>
+    void runChunks(size_t n_chunks, const Chunk &chunk);
+    template <typename Range>
+    void forChunks(size_t begin, size_t end, const Range &range);
+
+    std::vector<double> registers;
+    std::vector<size_t> register_signatures;
+    std::vector<PointerLoad> pointer_loads;
+    std::vector<CallbackLoad> callback_loads;
+    std::vector<Instruction> instructions;
+    std::vector<MatrixInstruction> matrix_instructions;
+    std::vector<Output> outputs;
+    std::vector<Copy> copies;
+    std::vector<CopyRun> copy_runs;
+    size_t output_count = 0;
+    // result blocks of the already lowered matrix operations
+    std::map<std::shared_ptr<const ParameterMatrix>, size_t> matrix_blocks;
+    // result registers of the already lowered operations
+    std::map<std::shared_ptr<ParameterOperation>, size_t> operation_nodes;
+
+    // registers of the already lowered values for common subexpression elimination
+    std::map<uint64_t, size_t> constant_registers;
+    std::map<std::pair<const double *, size_t>, size_t> pointer_registers;
+    std::map<const std::function<double()> *, size_t> callback_registers;
+    std::map<std::tuple<Opcode, size_t, size_t>, size_t> operation_registers;
+    std::map<std::vector<size_t>, size_t> matrix_registers;
+
+    // The signatures are sorted lists of block indices.
+    // Block 0 stands for pointers and callbacks, signature 0 is constant.
+    std::vector<ParameterBlock *> blocks{nullptr};
+    std::vector<std::vector<size_t>> signatures{{}};
+    std::map<std::vector<size_t>, size_t> signature_indices{{{}, 0}};
+    std::map<std::pair<size_t, size_t>, size_t> merged_signatures;
+    std::map<const ParameterBlock *, size_t> block_signatures;
+
+    std::vector<Segment> segments;
+    // end of each level in instructions
+    std::vector<size_t> level_ends;
+    // end of each chunk in copy_runs
+    std::vector<size_t> copy_chunk_ends;
+    ThreadPool *thread_pool = nullptr;
+    size_t min_parallel_chunks = 8;
+    bool finalized = false;
+
+    // the block versions that were last written to an output buffer
+    std::map<const double *, std::vector<size_t>> seen_versions;
+    // kept between updates, so that an update does not allocate
+    std::vector<bool> stale_signatures;
+};
+
+} // namespace internal
+
+} // namespace op
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "constraint.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <limits>
+#include <utility>
+
+namespace op
+{
+
+// Collects the variables, constraints and cost terms of one part of a problem,
+// so that independent parts can be formulated on different threads, e.g.
+//
+//     op::ProblemBuilder builder;
+//     op::ArenaScope scope(builder.getArena());
+//     op::Variable y = builder.createVariable("y", n);
+//     builder.addConstraint(y >= x);
+//
+// Every builder must only be used by one thread at a time. The variables that
+// the problem had before can be used in all builders.
+// The builders are merged into the problem with SecondOrderConeProgram::merge()
+// in the order of the calls, so the result does not depend on the thread timing.
+struct ProblemBuilder
+{
+    // The arena of the builder requests its memory from upstream
+    explicit ProblemBuilder(std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+    // The problem takes over the arena when the builder is merged
+    std::pmr::memory_resource *getArena() const;
+
+    // The variable is numbered when the builder is merged. Until then it can only be used
+    // in the expressions of this builder, afterwards the problem returns it with getVariable().
+    Variable createVariable(const std::string &name,
+                            size_t rows = 1, size_t cols = 1);
+
+    void addConstraint(std::vector<internal::EqualityConstraint> constraints);
+    void addConstraint(std::vector<internal::PositiveConstraint> constraints);
+    void addConstraint(std::vector<internal::SecondOrderConeConstraint> constraints);
+
+    void addMinimizationTerm(Affine affine);
+
+    // Numbers the variables of the builder from the given index of the problem on
+    void relocateVariables(size_t first_index);
+
+    // The indices of the variables of a builder are marked until it is merged
+    static constexpr size_t local_index = size_t(1) << (std::numeric_limits<size_t>::digits - 1);
+
+    // declared first so that it is released after the expressions
+    std::shared_ptr<std::pmr::monotonic_buffer_resource> arena;
+
+    std::vector<std::string> variable_names;
+    std::vector<std::pair<size_t, size_t>> variable_shapes;
+    size_t n_variables = 0;
+
+    std::vector<internal::EqualityConstraint> equalityConstraints;
+    std::vector<internal::PositiveConstraint> positiveConstraints;
+    std::vector<internal::SecondOrderConeConstraint> secondOrderConeConstraints;
+    internal::AffineSum costFunction;
+};
+
+} // namespace op
@@ -1,25 +1,43 @@
 #pragma once
 
 #include "optimizationProblem.hpp"
+#include "problemBuilder.hpp"
 
 namespace op
 {
 
 struct SecondOrderConeProgram : public GenericOptimizationProblem
 {
+    using GenericOptimizationProblem::GenericOptimizationProblem;
+
     std::vector<internal::EqualityConstraint> equalityConstraints;
     std::vector<internal::PositiveConstraint> positiveConstraints;
     std::vector<internal::SecondOrderConeConstraint> secondOrderConeConstraints;
     internal::AffineSum costFunction;
+    bool frozen = false;
 
+    // The constraints and terms are moved into the problem.
     void addConstraint(std::vector<internal::EqualityConstraint> constraints);
     void addConstraint(std::vector<internal::PositiveConstraint> constraints);
     void addConstraint(std::vector<internal::SecondOrderConeConstraint> constraints);
 
-    void addMinimizationTerm(const Affine &affine);
+    void addMinimizationTerm(Affine affine);
+
+    // Appends the variables, constraints and cost terms of the builder.
+    // Merging the builders in a fixed order gives the same problem
+    // as formulating all parts on one thread in that order.
+    void merge(ProblemBuilder builder);
 
     void cleanUp();
 
+    // Releases the constraints, the cost function and the arena of the problem
+    // once a solver has been created from it. The variables and the solution stay
+    // available. Expressions that were built in the arena can not be used anymore.
+    // Returns a lower bound of the number of bytes released.
+    size_t freeze();
+    bool isFrozen() const;
+
+    // not available after freeze()
     bool isFeasible() const;
 
     friend std::ostream &operator<<(std::ostream &os, const SecondOrderConeProgram &socp);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+namespace op
+{
+
+namespace internal
+{
+
+// A fixed set of worker threads that are started once and wait for work.
+class ThreadPool
+{
+public:
+    // The calling thread counts as one of the threads.
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const;
+
+    // Calls task(0) ... task(n_tasks - 1) on all threads
+    // and returns when all of them are done.
+    // If a task throws, the remaining tasks are skipped and the first exception is rethrown.
+    void run(size_t n_tasks, const std::function<void(size_t)> &task);
+
+private:
+    void work();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    const std::function<void(size_t)> *task = nullptr;
+    size_t n_tasks = 0;
+    std::atomic<size_t> next_task{0};
+    size_t generation = 0;
+    size_t busy_workers = 0;
+    std::exception_ptr first_exception;
+    bool stopping = false;
+};
+
+} // namespace internal
+
+} // namespace op
@@ -18,22 +18,21 @@ namespace internal
 struct AffineTerm;
 struct AffineSum;
 
+// A coefficient of a Variable.
+// Only the index is stored, the name is kept once by the problem.
 class VariableSource
 {
 public:
     VariableSource() = default;
-    VariableSource(const std::string &name, size_t problem_index,
-                   size_t row, size_t col);
+    explicit VariableSource(size_t problem_index);
     size_t getProblemIndex() const;
     friend std::ostream &operator<<(std::ostream &os,
                                     const VariableSource &variable);
     operator AffineTerm() const;
     operator AffineSum() const;
-    std::string name;
 
 private:
     size_t problem_index;
-    std::pair<size_t, size_t> index;
 };
 
 } // namespace internal
@@ -53,7 +52,6 @@ public:
 
 private:
     std::string name;
-    // indices of the value in the solution vector x
 };
 
 } // namespace op
\ No newline at end of file
@@ -23,17 +23,9 @@ class EcosWrapper : public WrapperBase
     std::vector<long> A_rows_CCS_l;
     std::vector<long> G_rows_CCS_l;
 
-    std::vector<double> c_values1;
-    std::vector<double> h_values1;
-    std::vector<double> b_values1;
-    std::vector<double> G_data_CCS_values1;
-    std::vector<double> A_data_CCS_values1;
-
-    std::vector<double> c_values2;
-    std::vector<double> h_values2;
-    std::vector<double> b_values2;
-    std::vector<double> G_data_CCS_values2;
-    std::vector<double> A_data_CCS_values2;
+    // copies of parameter_values, ECOS scales them in place
+    std::vector<double> parameter_values1;
+    std::vector<double> parameter_values2;
 
 public:
     void initialize() override;
@@ -7,6 +7,14 @@
 namespace op
 {
 
+namespace internal
+{
+
+// also used by FixedEicosWrapper
+std::string eicosResultString(EiCOS::exitcode exitflag);
+
+} // namespace internal
+
 class EicosWrapper : public WrapperBase
 {
     using WrapperBase::WrapperBase;
@@ -15,12 +23,6 @@ class EicosWrapper : public WrapperBase
 
     std::unique_ptr<EiCOS::Solver> solver;
 
-    std::vector<double> c_values;
-    std::vector<double> h_values;
-    std::vector<double> b_values;
-    std::vector<double> G_data_CCS_values;
-    std::vector<double> A_data_CCS_values;
-
 public:
     void initialize() override;
     bool solveProblem(bool verbose = false) override;
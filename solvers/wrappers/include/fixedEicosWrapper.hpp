@@ -0,0 +1,87 @@
+#pragma once
+
+#include "fixedWrapperBase.hpp"
+#include "eicosWrapper.hpp"
+
+#include <cassert>
+#include <optional>
+#include <string>
+
+namespace op
+{
+
+// EiCOS allocates its workspace in initialize(),
+// solveProblem() only evaluates the terms and hands the values over.
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+class FixedEicosWrapper : public FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>
+{
+    using Base = FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>;
+
+    EiCOS::exitcode last_exit_flag;
+
+    std::optional<EiCOS::Solver> solver;
+
+public:
+    explicit FixedEicosWrapper(FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms> &socp)
+        : Base(socp) {}
+    void initialize();
+    bool solveProblem(bool verbose = false);
+    std::string getResultString() const;
+};
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+void FixedEicosWrapper<MaxVariables, MaxRows, MaxTerms>::initialize()
+{
+    double *values = this->parameter_values.data();
+
+    solver.emplace(this->n_variables,
+                   this->n_constraint_rows,
+                   this->n_equalities,
+                   this->n_positive_constraints,
+                   this->n_cone_constraints,
+                   this->cone_constraint_dimensions.data(),
+                   values + Base::G_data_CCS_offset,
+                   this->G_columns_CCS.data(),
+                   this->G_rows_CCS.data(),
+                   values + Base::A_data_CCS_offset,
+                   this->A_columns_CCS.data(),
+                   this->A_rows_CCS.data(),
+                   values + Base::c_offset,
+                   values + Base::h_offset,
+                   values + Base::b_offset);
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+bool FixedEicosWrapper<MaxVariables, MaxRows, MaxTerms>::solveProblem(bool verbose)
+{
+    assert(solver and "You must first call initialize()!");
+
+    this->updateParameters();
+    double *values = this->parameter_values.data();
+
+    solver->updateData(values + Base::G_data_CCS_offset,
+                       values + Base::A_data_CCS_offset,
+                       values + Base::c_offset,
+                       values + Base::h_offset,
+                       values + Base::b_offset);
+
+    EiCOS::exitcode exitflag = solver->solve(verbose);
+
+    // copy solution
+    for (int i = 0; i < solver->solution().size(); i++)
+    {
+        this->socp.solution_vector[i] = solver->solution()(i);
+    }
+
+    last_exit_flag = exitflag;
+
+    return exitflag != EiCOS::exitcode::fatal;
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+std::string FixedEicosWrapper<MaxVariables, MaxRows, MaxTerms>::getResultString() const
+{
+    return internal::eicosResultString(last_exit_flag);
+}
+
+} // namespace op
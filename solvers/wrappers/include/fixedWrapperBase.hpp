@@ -0,0 +1,201 @@
+#pragma once
+
+#include "fixedSizeProblem.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace op
+{
+
+// Canonicalizes a FixedSecondOrderConeProgram into the same standard form as
+// WrapperBase, with the CCS structure of G and A stored in arrays of the capacity
+// of the problem. The structure is built once in the constructor and every term
+// of the problem remembers the coefficient of the standard form it is added to,
+// so updating the parameters before a solve does not allocate.
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+class FixedWrapperBase
+{
+protected:
+    FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms> &socp;
+
+    int n_variables = 0;
+    int n_constraint_rows = 0;
+    int n_equalities = 0;
+    int n_positive_constraints = 0;
+    int n_cone_constraints = 0;
+    std::array<int, MaxRows> cone_constraint_dimensions{};
+    std::array<int, MaxVariables + 1> G_columns_CCS{};
+    std::array<int, MaxTerms> G_rows_CCS{};
+    std::array<int, MaxVariables + 1> A_columns_CCS{};
+    std::array<int, MaxTerms> A_rows_CCS{};
+
+    // the values of the standard form [c, h, b, G, A]
+    static constexpr size_t c_offset = 0;
+    static constexpr size_t h_offset = c_offset + MaxVariables;
+    static constexpr size_t b_offset = h_offset + MaxRows;
+    static constexpr size_t G_data_CCS_offset = b_offset + MaxRows;
+    static constexpr size_t A_data_CCS_offset = G_data_CCS_offset + MaxTerms;
+    std::array<double, A_data_CCS_offset + MaxTerms> parameter_values{};
+
+    // the constant of a minimization term is not part of the standard form
+    static constexpr size_t no_destination = std::numeric_limits<size_t>::max();
+    std::array<size_t, MaxTerms> term_destinations{};
+    std::array<double, MaxTerms> term_signs{};
+
+    // Evaluates the terms of the problem into parameter_values
+    void updateParameters();
+
+public:
+    explicit FixedWrapperBase(FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms> &socp);
+
+private:
+    // a coefficient of G or A and the term of the problem that is added to it
+    struct Entry
+    {
+        int col;
+        int row;
+        size_t term;
+    };
+    // Sorts the entries by column and row and merges repeated positions
+    void compressEntries(std::array<Entry, MaxTerms> &entries, size_t n_entries,
+                         std::array<int, MaxVariables + 1> &columns_CCS,
+                         std::array<int, MaxTerms> &rows_CCS,
+                         size_t data_offset);
+};
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::FixedWrapperBase(FixedSecondOrderConeProgram<MaxVariables, MaxRows, MaxTerms> &socp)
+    : socp(socp)
+{
+    using Type = internal::FixedRow::Type;
+
+    n_variables = int(socp.n_variables);
+    for (size_t r = 0; r < socp.n_rows; r++)
+    {
+        const internal::FixedRow &row = socp.rows[r];
+        if (row.type == Type::Equality)
+        {
+            n_equalities++;
+        }
+        else if (row.type == Type::Positive)
+        {
+            n_positive_constraints++;
+        }
+        else if (row.type == Type::Cone and row.cone_size > 0)
+        {
+            cone_constraint_dimensions[n_cone_constraints++] = int(row.cone_size);
+        }
+    }
+    n_constraint_rows = n_positive_constraints;
+    for (int i = 0; i < n_cone_constraints; i++)
+    {
+        n_constraint_rows += cone_constraint_dimensions[i];
+    }
+
+    // The rows of G are the positive constraints followed by the cones.
+    std::array<Entry, MaxTerms> G_entries;
+    std::array<Entry, MaxTerms> A_entries;
+    size_t n_G_entries = 0;
+    size_t n_A_entries = 0;
+    int equality_row = 0;
+    int positive_row = 0;
+    int cone_row = n_positive_constraints;
+    for (size_t r = 0; r < socp.n_rows; r++)
+    {
+        const internal::FixedRow &row = socp.rows[r];
+        int row_index = 0;
+        if (row.type == Type::Equality)
+        {
+            row_index = equality_row++;
+        }
+        else if (row.type == Type::Positive)
+        {
+            row_index = positive_row++;
+        }
+        else if (row.type == Type::Cone)
+        {
+            row_index = cone_row++;
+        }
+
+        for (size_t t = row.first_term; t < row.first_term + row.n_terms; t++)
+        {
+            const internal::FixedTerm &term = socp.terms[t];
+            term_signs[t] = 1.;
+            if (term.variable == internal::FixedTerm::no_variable)
+            {
+                if (row.type == Type::Cost)
+                {
+                    term_destinations[t] = no_destination;
+                }
+                else if (row.type == Type::Equality)
+                {
+                    term_destinations[t] = b_offset + row_index;
+                }
+                else
+                {
+                    term_destinations[t] = h_offset + row_index;
+                }
+            }
+            else if (row.type == Type::Cost)
+            {
+                term_destinations[t] = c_offset + term.variable;
+            }
+            else if (row.type == Type::Equality)
+            {
+                A_entries[n_A_entries++] = {int(term.variable), row_index, t};
+            }
+            else
+            {
+                G_entries[n_G_entries++] = {int(term.variable), row_index, t};
+            }
+        }
+    }
+    compressEntries(G_entries, n_G_entries, G_columns_CCS, G_rows_CCS, G_data_CCS_offset);
+    compressEntries(A_entries, n_A_entries, A_columns_CCS, A_rows_CCS, A_data_CCS_offset);
+
+    updateParameters();
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+void FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::compressEntries(std::array<Entry, MaxTerms> &entries, size_t n_entries,
+                                                                      std::array<int, MaxVariables + 1> &columns_CCS,
+                                                                      std::array<int, MaxTerms> &rows_CCS,
+                                                                      size_t data_offset)
+{
+    std::sort(entries.begin(), entries.begin() + n_entries,
+              [](const Entry &a, const Entry &b) { return std::tie(a.col, a.row) < std::tie(b.col, b.row); });
+
+    size_t n_nonzeros = 0;
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        const Entry &entry = entries[i];
+        if (i == 0 or entry.col != entries[i - 1].col or entry.row != entries[i - 1].row)
+        {
+            rows_CCS[n_nonzeros++] = entry.row;
+            columns_CCS[entry.col + 1]++;
+        }
+        // G and A hold the negative coefficients
+        term_destinations[entry.term] = data_offset + n_nonzeros - 1;
+        term_signs[entry.term] = -1.;
+    }
+    std::partial_sum(columns_CCS.begin(), columns_CCS.end(), columns_CCS.begin());
+}
+
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+void FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::updateParameters()
+{
+    parameter_values.fill(0.);
+    for (size_t t = 0; t < socp.n_terms; t++)
+    {
+        if (term_destinations[t] != no_destination)
+        {
+            parameter_values[term_destinations[t]] += term_signs[t] * socp.terms[t].value();
+        }
+    }
+}
+
+} // namespace op
@@ -1,10 +1,34 @@
 #pragma once
 
 #include "secondOrderConeProgram.hpp"
+#include "parameterTape.hpp"
+
+#include <memory>
+#include <future>
+#include <mutex>
+#include <istream>
+#include <ostream>
 
 namespace op
 {
 
+// Counters of the last parameter update
+struct ParameterUpdateStatistics
+{
+    size_t refreshed = 0; // coefficients that were recomputed
+    size_t total = 0;     // coefficients in the problem
+};
+
+// How the parameters are evaluated before each solve
+struct ParameterEvaluationStrategy
+{
+    size_t threads = 1;
+    // ranges with fewer chunks of 4096 values are evaluated on one thread
+    size_t min_parallel_chunks = 8;
+};
+std::ostream &operator<<(std::ostream &os, const ParameterEvaluationStrategy &strategy);
+std::istream &operator>>(std::istream &is, ParameterEvaluationStrategy &strategy);
+
 class WrapperBase
 {
 protected:
@@ -27,11 +51,66 @@ protected:
     std::vector<internal::ParameterSource> h;
     std::vector<internal::ParameterSource> b;
 
+    // all parameters above compiled into one tape with the outputs [c, h, b, G, A]
+    internal::ParameterTape parameter_tape;
+    size_t c_offset;
+    size_t h_offset;
+    size_t b_offset;
+    size_t G_data_CCS_offset;
+    size_t A_data_CCS_offset;
+    std::vector<double> parameter_values;
+    ParameterUpdateStatistics parameter_statistics;
+    ParameterEvaluationStrategy parameter_strategy;
+    std::unique_ptr<internal::ThreadPool> thread_pool;
+
+    // parameters for the next solve that are evaluated in the background
+    std::vector<double> staged_parameter_values;
+    std::future<size_t> staged_update;
+    // guards the staged update, the parameter buffers and the tape,
+    // since stageParameters() can be called from another thread than the solve
+    std::mutex staging_mutex;
+
+    // Recomputes the stale coefficients in parameter_values
+    // or waits for the staged parameters and swaps them in
+    void updateParameters();
+    // the setters without taking staging_mutex
+    void startParameterThreads(size_t threads);
+    void applyParameterEvaluationStrategy(const ParameterEvaluationStrategy &strategy);
+
 public:
+    // Throws if the problem is frozen, since its constraints are no longer available
     explicit WrapperBase(SecondOrderConeProgram &_socp);
     virtual bool solveProblem(bool verbose = false) = 0;
     virtual std::string getResultString() const = 0;
     virtual void initialize() = 0;
+    const ParameterUpdateStatistics &getParameterStatistics() const;
+
+    // Evaluates the parameters of large problems on the given number of threads.
+    // The threads are started here and reused for every solve.
+    void setParameterThreads(size_t threads);
+
+    // Starts evaluating the parameters for the next solve on a background thread,
+    // e.g. as soon as new data has arrived while the current solve is still running.
+    // It can be called from another thread than solveProblem().
+    // The next solveProblem() waits for it and uses these values.
+    // The pointers, scalar and matrix callbacks and ParameterBlock::acquire() are read and run
+    // on the background thread, so the parameters must not be changed until then and no block
+    // may be set() or touch()ed; new values can be handed over with ParameterBlock::publish().
+    void stageParameters();
+
+    // The strategy can be saved with operator<< and restored in another process.
+    void setParameterEvaluationStrategy(const ParameterEvaluationStrategy &strategy);
+    const ParameterEvaluationStrategy &getParameterEvaluationStrategy() const;
+
+    // Times a full evaluation of the parameters of this problem with different
+    // numbers of threads and parallel thresholds, and selects the fastest one.
+    const ParameterEvaluationStrategy &calibrateParameterEvaluation(size_t repetitions = 5);
+
+    // Keeps only what is needed to solve the problem again with new parameter values:
+    // the compiled parameters, the sparsity structure and the variables.
+    // Everything else, including the expressions of the problem (see SecondOrderConeProgram::freeze),
+    // is released. Returns a lower bound of the number of bytes released.
+    size_t freeze();
 };
 
 } // namespace op
\ No newline at end of file
@@ -12,28 +12,11 @@ static_assert(std::is_same_v<idxint, SuiteSparse_long> and std::is_same_v<idxint
 namespace op
 {
 
-void ecos_get_parameter_values(const std::vector<internal::ParameterSource> &params,
-                               double factor,
-                               std::vector<double> &values)
-{
-    assert(values.size() == params.size());
-    std::transform(params.begin(), params.end(), values.begin(),
-                   [factor](const auto &param) { return param.get_value() * factor; });
-}
-
 void EcosWrapper::initialize()
 {
-    G_data_CCS_values1.resize(G_data_CCS.size());
-    A_data_CCS_values1.resize(A_data_CCS.size());
-    c_values1.resize(n_variables);
-    h_values1.resize(n_constraint_rows);
-    b_values1.resize(n_equalities);
-
-    G_data_CCS_values2.resize(G_data_CCS.size());
-    A_data_CCS_values2.resize(A_data_CCS.size());
-    c_values2.resize(n_variables);
-    h_values2.resize(n_constraint_rows);
-    b_values2.resize(n_equalities);
+    parameter_values1.resize(parameter_values.size());
+    parameter_values2.resize(parameter_values.size());
+    double *values = parameter_values1.data();
 
     cone_constraint_dimensions_l = std::vector<long>(cone_constraint_dimensions.begin(), cone_constraint_dimensions.end());
     A_rows_CCS_l = std::vector<long>(A_rows_CCS.begin(), A_rows_CCS.end());
@@ -49,15 +32,15 @@ void EcosWrapper::initialize()
         n_cone_constraints,
         cone_constraint_dimensions_l.data(),
         n_exponential_cones,
-        G_data_CCS_values1.data(),
+        values + G_data_CCS_offset,
         G_columns_CCS_l.data(),
         G_rows_CCS_l.data(),
-        A_data_CCS_values1.data(),
+        values + A_data_CCS_offset,
         A_columns_CCS_l.data(),
         A_rows_CCS_l.data(),
-        c_values1.data(),
-        h_values1.data(),
-        b_values1.data());
+        values + c_offset,
+        values + h_offset,
+        values + b_offset);
 
     if (std::any_cast<pwork*>(work) == nullptr)
     {
@@ -75,42 +58,26 @@ bool EcosWrapper::solveProblem(bool verbose)
     ecos_work->stgs->verbose = verbose;
 
     // awkward switching between memory locations
-    std::vector<double> *c_values;
-    std::vector<double> *h_values;
-    std::vector<double> *b_values;
-    std::vector<double> *G_data_CCS_values;
-    std::vector<double> *A_data_CCS_values;
+    double *values;
     if (step % 2 == 0)
     {
-        c_values = &c_values1;
-        h_values = &h_values1;
-        b_values = &b_values1;
-        G_data_CCS_values = &G_data_CCS_values1;
-        A_data_CCS_values = &A_data_CCS_values1;
+        values = parameter_values1.data();
     }
     else
     {
-        c_values = &c_values2;
-        h_values = &h_values2;
-        b_values = &b_values2;
-        G_data_CCS_values = &G_data_CCS_values2;
-        A_data_CCS_values = &A_data_CCS_values2;
+        values = parameter_values2.data();
     }
     step++;
 
-    ecos_get_parameter_values(c, 1.0, *c_values);
-    ecos_get_parameter_values(h, 1.0, *h_values);
-    ecos_get_parameter_values(b, 1.0, *b_values);
-    ecos_get_parameter_values(G_data_CCS, -1.0, *G_data_CCS_values);
-    ecos_get_parameter_values(A_data_CCS, -1.0, *A_data_CCS_values);
-    // The signs for A and G must be flipped because they are negative in the ECOS interface
+    updateParameters();
+    std::copy(parameter_values.begin(), parameter_values.end(), values);
 
     ECOS_updateData(ecos_work,
-                    G_data_CCS_values->data(),
-                    A_data_CCS_values->data(),
-                    c_values->data(),
-                    h_values->data(),
-                    b_values->data());
+                    values + G_data_CCS_offset,
+                    values + A_data_CCS_offset,
+                    values + c_offset,
+                    values + h_offset,
+                    values + b_offset);
 
     exitflag = ECOS_solve(ecos_work);
 
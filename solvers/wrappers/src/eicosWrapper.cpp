@@ -5,11 +5,7 @@ namespace op
 
 void EicosWrapper::initialize()
 {
-    G_data_CCS_values.resize(G_data_CCS.size());
-    A_data_CCS_values.resize(A_data_CCS.size());
-    c_values.resize(n_variables);
-    h_values.resize(n_constraint_rows);
-    b_values.resize(n_equalities);
+    double *values = parameter_values.data();
 
     solver = std::make_unique<EiCOS::Solver>(n_variables,
                                              n_constraint_rows,
@@ -17,42 +13,29 @@ void EicosWrapper::initialize()
                                              n_positive_constraints,
                                              n_cone_constraints,
                                              cone_constraint_dimensions.data(),
-                                             G_data_CCS_values.data(),
+                                             values + G_data_CCS_offset,
                                              G_columns_CCS.data(),
                                              G_rows_CCS.data(),
-                                             A_data_CCS_values.data(),
+                                             values + A_data_CCS_offset,
                                              A_columns_CCS.data(),
                                              A_rows_CCS.data(),
-                                             c_values.data(),
-                                             h_values.data(),
-                                             b_values.data());
-}
-
-void get_parameter_values(const std::vector<internal::ParameterSource> &params,
-                          double factor,
-                          std::vector<double> &values)
-{
-    assert(values.size() == params.size());
-    std::transform(params.begin(), params.end(), values.begin(),
-                   [factor](const auto &param) { return param.get_value() * factor; });
+                                             values + c_offset,
+                                             values + h_offset,
+                                             values + b_offset);
 }
 
 bool EicosWrapper::solveProblem(bool verbose)
 {
     assert(solver != nullptr && "You must first call initialize()!");
 
-    get_parameter_values(c, 1.0, c_values);
-    get_parameter_values(h, 1.0, h_values);
-    get_parameter_values(b, 1.0, b_values);
-    get_parameter_values(G_data_CCS, -1.0, G_data_CCS_values);
-    get_parameter_values(A_data_CCS, -1.0, A_data_CCS_values);
-    // The signs for A and G must be flipped because they are negative in the EiCOS interface
+    updateParameters();
+    double *values = parameter_values.data();
 
-    solver->updateData(G_data_CCS_values.data(),
-                       A_data_CCS_values.data(),
-                       c_values.data(),
-                       h_values.data(),
-                       b_values.data());
+    solver->updateData(values + G_data_CCS_offset,
+                       values + A_data_CCS_offset,
+                       values + c_offset,
+                       values + h_offset,
+                       values + b_offset);
 
     EiCOS::exitcode exitflag = solver->solve(verbose);
 
@@ -69,7 +52,15 @@ bool EicosWrapper::solveProblem(bool verbose)
 
 std::string EicosWrapper::getResultString() const
 {
-    switch (last_exit_flag)
+    return internal::eicosResultString(last_exit_flag);
+}
+
+namespace internal
+{
+
+std::string eicosResultString(EiCOS::exitcode exitflag)
+{
+    switch (exitflag)
     {
     case EiCOS::exitcode::optimal:
         return "Optimal solution found.";
@@ -98,4 +89,6 @@ std::string EicosWrapper::getResultString() const
     }
 }
 
+} // namespace internal
+
 } // namespace op
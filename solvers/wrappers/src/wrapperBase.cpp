@@ -1,10 +1,12 @@
 #include <stdexcept>
 #include <algorithm>
-#include <numeric>
 #include <tuple>
 #include <functional>
 #include <cassert>
 #include <sstream>
+#include <chrono>
+#include <thread>
+#include <limits>
 
 #include "wrapperBase.hpp"
 
@@ -16,55 +18,14 @@ using std::vector;
 namespace op
 {
 
-bool check_unique_variables_in_affine_expression(const internal::AffineSum &affineSum)
-{
-    // check if a variable is used more than once in an expression
-
-    vector<size_t> variable_indices;
-    for (const auto &term : affineSum.terms)
-    {
-        if (term.variable)
-        { // only consider linear terms, not constant terms
-            const size_t idx = term.variable.value().getProblemIndex();
-            if (std::find(variable_indices.begin(), variable_indices.end(), idx) != variable_indices.end())
-            {
-                // duplicate found!
-                return false;
-            }
-            variable_indices.push_back(idx);
-        }
-    }
-    return true;
-}
-
-void error_check_affine_expression(const internal::AffineSum &affineSum)
+internal::ParameterSource accumulate_constants(const internal::AffineSum &affineSum)
 {
-    if (!check_unique_variables_in_affine_expression(affineSum))
+    internal::ParameterSource sum(0.);
+    for (const auto &constant : affineSum.constants)
     {
-        std::stringstream ss;
-        ss << "Error: Duplicate variable in the expression: \n"
-           << affineSum;
-        throw std::runtime_error(ss.str());
+        sum += constant;
     }
-}
-
-internal::ParameterSource accumulate_constants(const internal::AffineSum &affineSum)
-{
-    auto pick_constant = [](const internal::ParameterSource &sum, const internal::AffineTerm &term) {
-        if (term.variable)
-        {
-            return sum;
-        }
-        else
-        {
-            return sum + term.parameter;
-        }
-    };
-
-    return std::accumulate(affineSum.terms.begin(),
-                           affineSum.terms.end(),
-                           internal::ParameterSource(0.),
-                           pick_constant);
+    return sum;
 }
 
 // convert sparse matrix format "dictionary of keys" to "column compressed storage"
@@ -119,18 +80,18 @@ void copy_affine_expression_linear_parts_to_sparse_DOK(
     const internal::AffineSum &affineSum,
     size_t row_index)
 {
-    for (const auto &term : affineSum.terms)
+    for (size_t i = 0; i < affineSum.variables.size(); i++)
     {
-        if (term.variable)
-        { // only consider linear terms, not constant terms
-            size_t column_index = term.variable.value().getProblemIndex();
-            sparse_DOK[std::make_pair(row_index, column_index)] = term.parameter;
-        }
+        sparse_DOK[std::make_pair(row_index, affineSum.variables[i])] = affineSum.coefficients[i];
     }
 }
 
 WrapperBase::WrapperBase(SecondOrderConeProgram &_socp) : socp(_socp)
 {
+    if (socp.isFrozen())
+    {
+        throw std::runtime_error("Can not create a solver for a frozen problem, its constraints were released.");
+    }
     socp.cleanUp();
 
     /* ECOS size parameters */
@@ -146,25 +107,6 @@ WrapperBase::WrapperBase(SecondOrderConeProgram &_socp) : socp(_socp)
         cone_constraint_dimensions.push_back(1 + cone.norm2.arguments.size());
     }
 
-    /* Error checking for the problem description */
-    for (const auto &cone : socp.secondOrderConeConstraints)
-    {
-        error_check_affine_expression(cone.affine);
-        for (const auto &affine_expression : cone.norm2.arguments)
-        {
-            error_check_affine_expression(affine_expression);
-        }
-    }
-    for (const auto &positiveConstraint : socp.positiveConstraints)
-    {
-        error_check_affine_expression(positiveConstraint.affine);
-    }
-    for (const auto &equalityConstraint : socp.equalityConstraints)
-    {
-        error_check_affine_expression(equalityConstraint.affine);
-    }
-    error_check_affine_expression(socp.costFunction);
-
     /* Build equality constraint parameters (b - A * x == 0) */
     {
         // Construct the sparse A matrix in the "Dictionary of keys" format
@@ -220,14 +162,171 @@ WrapperBase::WrapperBase(SecondOrderConeProgram &_socp) : socp(_socp)
     /* Build cost function parameters */
     {
         c.resize(n_variables);
-        for (const auto &term : socp.costFunction.terms)
+        for (size_t i = 0; i < socp.costFunction.variables.size(); i++)
         {
-            if (term.variable)
+            c[socp.costFunction.variables[i]] = socp.costFunction.coefficients[i];
+        }
+    }
+
+    /* Compile the parameters */
+    {
+        // The signs for A and G are flipped because they are negative in the solver interfaces
+        c_offset = parameter_tape.addOutputs(c);
+        h_offset = parameter_tape.addOutputs(h);
+        b_offset = parameter_tape.addOutputs(b);
+        G_data_CCS_offset = parameter_tape.addOutputs(G_data_CCS, -1.);
+        A_data_CCS_offset = parameter_tape.addOutputs(A_data_CCS, -1.);
+    }
+    parameter_values.resize(parameter_tape.size());
+    parameter_statistics.total = parameter_tape.size();
+}
+
+void WrapperBase::updateParameters()
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    if (staged_update.valid())
+    {
+        parameter_statistics.refreshed = staged_update.get();
+        parameter_values.swap(staged_parameter_values);
+    }
+    else
+    {
+        parameter_statistics.refreshed = parameter_tape.update(parameter_values.data());
+    }
+}
+
+void WrapperBase::stageParameters()
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    if (staged_update.valid())
+    {
+        staged_update.get();
+    }
+    staged_parameter_values.resize(parameter_values.size());
+    staged_update = std::async(std::launch::async, [this]() {
+        return parameter_tape.update(staged_parameter_values.data());
+    });
+}
+
+const ParameterUpdateStatistics &WrapperBase::getParameterStatistics() const
+{
+    return parameter_statistics;
+}
+
+void WrapperBase::setParameterThreads(size_t threads)
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    startParameterThreads(threads);
+}
+
+void WrapperBase::startParameterThreads(size_t threads)
+{
+    if (staged_update.valid())
+    {
+        staged_update.wait();
+    }
+    parameter_tape.setThreadPool(nullptr);
+    thread_pool.reset();
+    if (threads > 1)
+    {
+        thread_pool = std::make_unique<internal::ThreadPool>(threads);
+        parameter_tape.setThreadPool(thread_pool.get());
+    }
+    parameter_strategy.threads = std::max<size_t>(threads, 1);
+}
+
+void WrapperBase::setParameterEvaluationStrategy(const ParameterEvaluationStrategy &strategy)
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    applyParameterEvaluationStrategy(strategy);
+}
+
+void WrapperBase::applyParameterEvaluationStrategy(const ParameterEvaluationStrategy &strategy)
+{
+    if (strategy.threads != parameter_strategy.threads)
+    {
+        startParameterThreads(strategy.threads);
+    }
+    parameter_tape.setMinParallelChunks(strategy.min_parallel_chunks);
+    parameter_strategy.min_parallel_chunks = strategy.min_parallel_chunks;
+}
+
+const ParameterEvaluationStrategy &WrapperBase::getParameterEvaluationStrategy() const
+{
+    return parameter_strategy;
+}
+
+const ParameterEvaluationStrategy &WrapperBase::calibrateParameterEvaluation(size_t repetitions)
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    if (staged_update.valid())
+    {
+        staged_update.wait();
+    }
+
+    vector<ParameterEvaluationStrategy> candidates{{1, 8}};
+    const size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t threads = 2; threads <= max_threads; threads *= 2)
+    {
+        for (size_t min_parallel_chunks : {2, 8, 32})
+        {
+            candidates.push_back({threads, min_parallel_chunks});
+        }
+    }
+
+    // take the best of the repetitions for each candidate
+    ParameterEvaluationStrategy fastest = candidates.front();
+    double fastest_time = std::numeric_limits<double>::infinity();
+    for (const ParameterEvaluationStrategy &candidate : candidates)
+    {
+        applyParameterEvaluationStrategy(candidate);
+        for (size_t i = 0; i < repetitions; i++)
+        {
+            parameter_tape.invalidate();
+            const auto start = std::chrono::steady_clock::now();
+            parameter_tape.update(parameter_values.data());
+            const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+            if (time.count() < fastest_time)
             {
-                c[term.variable.value().getProblemIndex()] = term.parameter;
+                fastest_time = time.count();
+                fastest = candidate;
             }
         }
     }
+
+    applyParameterEvaluationStrategy(fastest);
+    return parameter_strategy;
+}
+
+size_t WrapperBase::freeze()
+{
+    std::lock_guard<std::mutex> lock(staging_mutex);
+    if (staged_update.valid())
+    {
+        staged_update.wait();
+    }
+
+    // the tape keeps the pointers, callbacks and blocks of the parameters
+    size_t released = parameter_tape.compact();
+    for (auto *parameters : {&G_data_CCS, &A_data_CCS, &c, &h, &b})
+    {
+        released += parameters->capacity() * sizeof(internal::ParameterSource);
+        vector<internal::ParameterSource>().swap(*parameters);
+    }
+    released += socp.freeze();
+    return released;
+}
+
+std::ostream &operator<<(std::ostream &os, const ParameterEvaluationStrategy &strategy)
+{
+    os << strategy.threads << " " << strategy.min_parallel_chunks;
+    return os;
+}
+
+std::istream &operator>>(std::istream &is, ParameterEvaluationStrategy &strategy)
+{
+    is >> strategy.threads >> strategy.min_parallel_chunks;
+    return is;
 }
 
 } // namespace op
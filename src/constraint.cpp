@@ -9,15 +9,15 @@ namespace op
 namespace internal
 {
 
-EqualityConstraint::EqualityConstraint(const internal::AffineSum &affine)
-    : affine(affine) {}
+EqualityConstraint::EqualityConstraint(internal::AffineSum affine)
+    : affine(std::move(affine)) {}
 
-EqualityConstraint operator==(const internal::AffineSum &affine, const double zero)
+EqualityConstraint operator==(internal::AffineSum affine, const double zero)
 {
     assert(zero == 0.0);
     (void)zero;
 
-    return EqualityConstraint(affine);
+    return EqualityConstraint(std::move(affine));
 }
 
 std::ostream &operator<<(std::ostream &os, const EqualityConstraint &constraint)
@@ -31,8 +31,8 @@ double EqualityConstraint::evaluate(const std::vector<double> &soln_values) cons
     return -affine.evaluate(soln_values);
 }
 
-PositiveConstraint::PositiveConstraint(const internal::AffineSum &affine)
-    : affine(affine) {}
+PositiveConstraint::PositiveConstraint(internal::AffineSum affine)
+    : affine(std::move(affine)) {}
 
 std::ostream &operator<<(std::ostream &os, const PositiveConstraint &constraint)
 {
@@ -45,22 +45,22 @@ double PositiveConstraint::evaluate(const std::vector<double> &soln_values) cons
     return -affine.evaluate(soln_values);
 }
 
-PositiveConstraint operator>=(const internal::AffineSum &affine, const double zero)
+PositiveConstraint operator>=(internal::AffineSum affine, const double zero)
 {
     assert(zero == 0.0);
     (void)zero;
 
-    return PositiveConstraint(affine);
+    return PositiveConstraint(std::move(affine));
 }
 
-PositiveConstraint operator<=(const double zero, const internal::AffineSum &affine)
+PositiveConstraint operator<=(const double zero, internal::AffineSum affine)
 {
-    return affine >= zero;
+    return std::move(affine) >= zero;
 }
 
-SecondOrderConeConstraint::SecondOrderConeConstraint(const internal::Norm2Term &norm2,
-                                                     const internal::AffineSum &affine)
-    : norm2(norm2), affine(affine) {}
+SecondOrderConeConstraint::SecondOrderConeConstraint(internal::Norm2Term norm2,
+                                                     internal::AffineSum affine)
+    : norm2(std::move(norm2)), affine(std::move(affine)) {}
 
 std::ostream &operator<<(std::ostream &os, const SecondOrderConeConstraint &constraint)
 {
@@ -75,7 +75,24 @@ double SecondOrderConeConstraint::evaluate(const std::vector<double> &soln_value
 
 } // namespace internal
 
-std::vector<internal::EqualityConstraint> operator==(const Affine &affine, const double zero)
+namespace
+{
+
+internal::AffineSum negated(internal::AffineSum sum)
+{
+    sum *= internal::ParameterSource(-1.);
+    return sum;
+}
+
+internal::AffineSum concatenated(internal::AffineSum first, internal::AffineSum second)
+{
+    first += std::move(second);
+    return first;
+}
+
+} // namespace
+
+std::vector<internal::EqualityConstraint> operator==(Affine affine, const double zero)
 {
     assert(zero == 0.0);
     (void)zero;
@@ -84,11 +101,11 @@ std::vector<internal::EqualityConstraint> operator==(const Affine &affine, const
     constraints.reserve(affine.size());
     for (auto [row, col] : affine.all_indices())
     {
-        constraints.push_back(affine.coeff(row, col) == 0.0);
+        constraints.push_back(std::move(affine.coeffRef(row, col)) == 0.0);
     }
     return constraints;
 }
-std::vector<internal::EqualityConstraint> operator==(const Affine &lhs, const Affine &rhs)
+std::vector<internal::EqualityConstraint> operator==(Affine lhs, Affine rhs)
 {
     assert(lhs.shape() == rhs.shape() or lhs.is_scalar() or rhs.is_scalar());
 
@@ -100,45 +117,44 @@ std::vector<internal::EqualityConstraint> operator==(const Affine &lhs, const Af
         {
             if (not lhs.is_scalar() and not rhs.is_scalar())
             {
-                constraints.push_back(rhs.coeff(row, col) + -lhs.coeff(row, col) == 0.);
+                constraints.push_back(concatenated(std::move(rhs.coeffRef(row, col)),
+                                                   negated(std::move(lhs.coeffRef(row, col)))) == 0.);
             }
             else if (lhs.is_scalar())
             {
-                constraints.push_back(rhs.coeff(row, col) + -lhs.coeff(0) == 0.);
+                constraints.push_back(concatenated(std::move(rhs.coeffRef(row, col)),
+                                                   negated(lhs.coeff(0))) == 0.);
             }
             else if (rhs.is_scalar())
             {
-                constraints.push_back(lhs.coeff(row, col) + -rhs.coeff(0) == 0.);
+                constraints.push_back(concatenated(std::move(lhs.coeffRef(row, col)),
+                                                   negated(rhs.coeff(0))) == 0.);
             }
         }
     }
     return constraints;
 }
 
-std::vector<internal::PositiveConstraint> operator>=(const Affine &affine, const double zero)
+std::vector<internal::PositiveConstraint> operator>=(Affine affine, const double zero)
 {
     assert(zero == 0.0);
     (void)zero;
 
     std::vector<internal::PositiveConstraint> constraints;
+    constraints.reserve(affine.size());
     for (auto [row, col] : affine.all_indices())
     {
-        constraints.push_back(affine.coeff(row, col) >= 0.0);
+        constraints.push_back(std::move(affine.coeffRef(row, col)) >= 0.0);
     }
     return constraints;
 }
 
-std::vector<internal::PositiveConstraint> operator<=(const double zero, const Affine &affine)
+std::vector<internal::PositiveConstraint> operator<=(const double zero, Affine affine)
 {
-    return affine >= zero;
+    return std::move(affine) >= zero;
 }
 
-std::vector<internal::PositiveConstraint> operator<=(const double &zero, const Affine &affine)
-{
-    return affine >= zero;
-}
-
-std::vector<internal::PositiveConstraint> operator>=(const Affine &lhs, const Affine &rhs)
+std::vector<internal::PositiveConstraint> operator>=(Affine lhs, Affine rhs)
 {
     assert(lhs.shape() == rhs.shape() or lhs.is_scalar() or rhs.is_scalar());
 
@@ -150,45 +166,47 @@ std::vector<internal::PositiveConstraint> operator>=(const Affine &lhs, const Af
         {
             if (not lhs.is_scalar() and not rhs.is_scalar())
             {
-                constraints.push_back(-rhs.coeff(row, col) + lhs.coeff(row, col) >= 0.);
+                constraints.push_back(concatenated(negated(std::move(rhs.coeffRef(row, col))),
+                                                   std::move(lhs.coeffRef(row, col))) >= 0.);
             }
             else if (lhs.is_scalar())
             {
-                constraints.push_back(lhs.coeff(0) + -rhs.coeff(row, col) >= 0.);
+                constraints.push_back(concatenated(lhs.coeff(0),
+                                                   negated(std::move(rhs.coeffRef(row, col)))) >= 0.);
             }
             else if (rhs.is_scalar())
             {
-                constraints.push_back(lhs.coeff(row, col) + -rhs.coeff(0) >= 0.);
+                constraints.push_back(concatenated(std::move(lhs.coeffRef(row, col)),
+                                                   negated(rhs.coeff(0))) >= 0.);
             }
         }
     }
     return constraints;
 }
 
-std::vector<internal::PositiveConstraint> operator<=(const Affine &lhs, const Affine &rhs)
+std::vector<internal::PositiveConstraint> operator<=(Affine lhs, Affine rhs)
 {
-    return rhs >= lhs;
+    return std::move(rhs) >= std::move(lhs);
 }
 
-std::vector<internal::SecondOrderConeConstraint> operator<=(const SOCLhs &socLhs, const Affine &affine)
+std::vector<internal::SecondOrderConeConstraint> operator<=(SOCLhs socLhs, Affine affine)
 {
     assert(socLhs.shape() == affine.shape() or affine.is_scalar()); //or socLhs.is_scalar()); // Maybe TODO
     std::vector<internal::SecondOrderConeConstraint> constraints;
+    constraints.reserve(socLhs.size());
 
     for (auto [row, col] : socLhs.all_indices())
     {
-        if (affine.is_scalar())
+        auto &[norm, lhs] = socLhs.coeffRef(row, col);
+        if (affine.is_scalar() and socLhs.size() > 1)
         {
-            internal::AffineSum rhs = affine.coeff(0);
-            rhs += -socLhs.coeff(0).second;
-            constraints.emplace_back(socLhs.coeff(row, col).first, rhs);
+            // every cone needs its own copy of the right hand side
+            constraints.emplace_back(std::move(norm), concatenated(affine.coeff(0), negated(std::move(lhs))));
         }
         else
         {
-            internal::AffineSum rhs = affine.coeff(row, col);
-            rhs += -socLhs.coeff(row, col).second;
-
-            constraints.emplace_back(socLhs.coeff(row, col).first, rhs);
+            internal::AffineSum &rhs = affine.is_scalar() ? affine.coeffRef(0) : affine.coeffRef(row, col);
+            constraints.emplace_back(std::move(norm), concatenated(std::move(rhs), negated(std::move(lhs))));
         }
     }
     return constraints;
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <cassert>
 #include <numeric>
+#include <algorithm>
 #include <cmath>
 
 namespace op
@@ -18,16 +19,16 @@ AffineTerm::AffineTerm(const ParameterSource &parameter)
     : parameter(parameter) {}
 
 AffineTerm::AffineTerm(const VariableSource &variable)
-    : parameter(1.0), variable(variable) {}
+    : parameter(1.0), variable(variable.getProblemIndex()) {}
 
 AffineTerm::AffineTerm(const ParameterSource &parameter, const VariableSource &variable)
-    : parameter(parameter), variable(variable) {}
+    : parameter(parameter), variable(variable.getProblemIndex()) {}
 
 std::ostream &operator<<(std::ostream &os, const AffineTerm &term)
 {
     os << term.parameter.get_value();
     if (term.variable)
-        os << "*" << term.variable.value();
+        os << "*x[" << term.variable.value() << "]";
     return os;
 }
 
@@ -36,7 +37,7 @@ double AffineTerm::evaluate(const std::vector<double> &soln_values) const
     double p = parameter.get_value();
     if (variable)
     {
-        return p * soln_values[variable.value().getProblemIndex()];
+        return p * soln_values[variable.value()];
     }
     else
     {
@@ -46,7 +47,7 @@ double AffineTerm::evaluate(const std::vector<double> &soln_values) const
 
 AffineTerm &AffineTerm::operator*=(const internal::ParameterSource &parameter)
 {
-    this->parameter = this->parameter * parameter;
+    this->parameter *= parameter;
     return *this;
 }
 
@@ -72,19 +73,63 @@ VariableSource::operator AffineTerm() const
     return AffineTerm(*this);
 }
 
-AffineSum::AffineSum(const ParameterSource &parameter) : terms{parameter} {}
+AffineSum::AffineSum()
+    : variables(expressionResource()),
+      coefficients(expressionResource()),
+      constants(expressionResource()) {}
 
-AffineSum::AffineSum(const VariableSource &variable) : terms{variable} {}
+AffineSum::AffineSum(const ParameterSource &parameter) : AffineSum()
+{
+    constants.push_back(parameter);
+}
+
+AffineSum::AffineSum(const VariableSource &variable) : AffineSum()
+{
+    addTerm(ParameterSource(1.0), variable.getProblemIndex());
+}
+
+AffineSum::AffineSum(const AffineSum &other)
+    : variables(other.variables, expressionResource()),
+      coefficients(other.coefficients, expressionResource()),
+      constants(other.constants, expressionResource()) {}
+
+AffineSum::AffineSum(const AffineTerm &term) : AffineSum()
+{
+    if (term.variable and not term.parameter.is_zero())
+    {
+        addTerm(term.parameter, term.variable.value());
+    }
+    else
+    {
+        constants.push_back(term.parameter);
+    }
+}
 
-AffineSum::AffineSum(const AffineTerm &term) : terms{term} {}
+void AffineSum::addTerm(const ParameterSource &parameter, size_t variable)
+{
+    variables.push_back(variable);
+    coefficients.push_back(parameter);
+}
+
+void AffineSum::reserve(size_t n_terms)
+{
+    variables.reserve(n_terms);
+    coefficients.reserve(n_terms);
+}
 
 std::ostream &operator<<(std::ostream &os, const AffineSum &expression)
 {
-    for (size_t i = 0; i < expression.terms.size(); i++)
+    for (size_t i = 0; i < expression.variables.size(); i++)
     {
         if (i > 0)
             os << " + ";
-        os << expression.terms[i];
+        os << expression.coefficients[i].get_value() << "*x[" << expression.variables[i] << "]";
+    }
+    for (size_t i = 0; i < expression.constants.size(); i++)
+    {
+        if (i > 0 or not expression.variables.empty())
+            os << " + ";
+        os << expression.constants[i].get_value();
     }
     return os;
 }
@@ -92,9 +137,13 @@ std::ostream &operator<<(std::ostream &os, const AffineSum &expression)
 double AffineSum::evaluate(const std::vector<double> &soln_values) const
 {
     double result = 0.;
-    for (const auto &term : terms)
+    for (size_t i = 0; i < variables.size(); i++)
+    {
+        result += coefficients[i].get_value() * soln_values[variables[i]];
+    }
+    for (const ParameterSource &constant : constants)
     {
-        result += term.evaluate(soln_values);
+        result += constant.get_value();
     }
     return result;
 }
@@ -102,18 +151,14 @@ double AffineSum::evaluate(const std::vector<double> &soln_values) const
 AffineSum AffineSum::operator+(const AffineSum &other) const
 {
     AffineSum result = *this;
-    result.terms.insert(result.terms.end(), other.terms.begin(), other.terms.end());
+    result += other;
     return result;
 }
 
 AffineSum AffineSum::operator*(const ParameterSource &parameter) const
 {
-    AffineSum result;
-    result.terms = terms;
-    for (AffineTerm &term : result.terms)
-    {
-        term *= parameter;
-    }
+    AffineSum result = *this;
+    result *= parameter;
     return result;
 }
 
@@ -125,29 +170,128 @@ AffineSum AffineSum::operator-() const
 size_t AffineSum::clean()
 {
     // erase variables that are multiplied by zero
-    auto erase_from = std::remove_if(terms.begin(),
-                                     terms.end(),
-                                     [](const AffineTerm &term) {
-                                         return term.parameter.is_zero();
-                                     });
-    const auto erase_to = terms.end();
-    const size_t erased_elements = std::distance(erase_from, erase_to);
-    terms.erase(erase_from, erase_to);
+    size_t kept = 0;
+    for (size_t i = 0; i < variables.size(); i++)
+    {
+        if (not coefficients[i].is_zero())
+        {
+            variables[kept] = variables[i];
+            coefficients[kept] = std::move(coefficients[i]);
+            kept++;
+        }
+    }
+    size_t erased_elements = variables.size() - kept;
+    variables.resize(kept);
+    coefficients.erase(coefficients.begin() + kept, coefficients.end());
+
+    const auto erase_from = std::remove_if(constants.begin(),
+                                           constants.end(),
+                                           [](const ParameterSource &constant) {
+                                               return constant.is_zero();
+                                           });
+    erased_elements += std::distance(erase_from, constants.end());
+    constants.erase(erase_from, constants.end());
 
     return erased_elements;
 }
 
+size_t AffineSum::merge_variables(std::vector<size_t> &positions)
+{
+    // positions[variable] is one past the index of its first term
+    size_t kept = 0;
+    for (size_t i = 0; i < variables.size(); i++)
+    {
+        size_t &position = positions[variables[i]];
+        if (position == 0)
+        {
+            variables[kept] = variables[i];
+            if (kept != i)
+            {
+                coefficients[kept] = std::move(coefficients[i]);
+            }
+            kept++;
+            position = kept;
+        }
+        else
+        {
+            coefficients[position - 1] += coefficients[i];
+        }
+    }
+    const size_t merged = variables.size() - kept;
+    variables.resize(kept);
+    coefficients.erase(coefficients.begin() + kept, coefficients.end());
+
+    for (size_t variable : variables)
+    {
+        positions[variable] = 0;
+    }
+    return merged;
+}
+
 bool AffineSum::is_constant() const
 {
-    return not std::any_of(terms.begin(), terms.end(),
-                           [](const AffineTerm &term) {
-                               return term.variable.has_value();
-                           });
+    return variables.empty();
 }
 
+size_t AffineSum::allocated_bytes() const
+{
+    return variables.capacity() * sizeof(size_t) +
+           (coefficients.capacity() + constants.capacity()) * sizeof(ParameterSource);
+}
+
+namespace
+{
+
+template <typename T>
+void append(std::pmr::vector<T> &elements, std::pmr::vector<T> &&other)
+{
+    if (elements.empty())
+    {
+        elements = std::move(other);
+    }
+    else
+    {
+        elements.insert(elements.end(),
+                        std::make_move_iterator(other.begin()),
+                        std::make_move_iterator(other.end()));
+    }
+}
+
+} // namespace
+
 AffineSum &AffineSum::operator+=(const AffineSum &other)
 {
-    terms.insert(terms.end(), other.terms.begin(), other.terms.end());
+    variables.insert(variables.end(), other.variables.begin(), other.variables.end());
+    coefficients.insert(coefficients.end(), other.coefficients.begin(), other.coefficients.end());
+    constants.insert(constants.end(), other.constants.begin(), other.constants.end());
+    return *this;
+}
+
+AffineSum &AffineSum::operator+=(AffineSum &&other)
+{
+    append(variables, std::move(other.variables));
+    append(coefficients, std::move(other.coefficients));
+    append(constants, std::move(other.constants));
+    return *this;
+}
+
+AffineSum &AffineSum::operator*=(const ParameterSource &parameter)
+{
+    if (parameter.is_zero())
+    {
+        variables.clear();
+        coefficients.clear();
+        constants.clear();
+        return *this;
+    }
+    for (ParameterSource &coefficient : coefficients)
+    {
+        coefficient *= parameter;
+    }
+    for (ParameterSource &constant : constants)
+    {
+        constant *= parameter;
+    }
     return *this;
 }
 
@@ -210,15 +354,11 @@ std::ostream &operator<<(std::ostream &os, const internal::Norm2Term &norm2)
 
 } // namespace internal
 
-Affine operator+(const Affine &lhs, const Affine &rhs)
+Affine operator+(Affine lhs, const Affine &rhs)
 {
     assert(lhs.shape() == rhs.shape());
-    Affine result = lhs;
-    for (auto [row, col] : lhs.all_indices())
-    {
-        result.coeffRef(row, col) += rhs.coeff(row, col);
-    }
-    return result;
+    lhs += rhs;
+    return lhs;
 }
 
 Affine operator*(const Parameter &parameter, const Variable &variable)
@@ -231,16 +371,33 @@ Affine operator*(const Parameter &parameter, const Variable &variable)
     {
         assert(parameter.cols() == variable.rows());
 
+        // structural zeros of the parameter create no terms
+        std::vector<size_t> row_terms(parameter.rows(), 0);
+        for (auto [row, inner] : parameter.all_indices())
+        {
+            row_terms[row] += not parameter.coeff(row, inner).is_zero();
+        }
+
         Affine result(parameter.rows(), variable.cols());
         for (auto [row, col] : result.all_indices())
         {
-            internal::AffineSum expression;
+            result.coeffRef(row, col).reserve(row_terms[row]);
+        }
+        // read the parameter column by column in storage order
+        for (size_t col = 0; col < variable.cols(); col++)
+        {
             for (size_t inner = 0; inner < parameter.cols(); inner++)
             {
-                expression.terms.emplace_back(parameter.coeff(row, inner),
-                                              variable.coeff(inner, col));
+                for (size_t row = 0; row < parameter.rows(); row++)
+                {
+                    const internal::ParameterSource &coefficient = parameter.coeff(row, inner);
+                    if (not coefficient.is_zero())
+                    {
+                        result.coeffRef(row, col).addTerm(coefficient,
+                                                          variable.coeff(inner, col).getProblemIndex());
+                    }
+                }
             }
-            result.coeffRef(row, col) = expression;
         }
         return result;
     }
@@ -279,13 +436,16 @@ Affine operator*(const Variable &variable, const Parameter &parameter)
         Affine result(variable.rows(), parameter.cols());
         for (auto [row, col] : result.all_indices())
         {
-            internal::AffineSum expression;
+            internal::AffineSum &expression = result.coeffRef(row, col);
+            expression.reserve(variable.cols());
             for (size_t inner = 0; inner < variable.cols(); inner++)
             {
-                expression.terms.emplace_back(parameter.coeff(inner, col),
-                                              variable.coeff(row, inner));
+                const internal::ParameterSource &coefficient = parameter.coeff(inner, col);
+                if (not coefficient.is_zero())
+                {
+                    expression.addTerm(coefficient, variable.coeff(row, inner).getProblemIndex());
+                }
             }
-            result.coeffRef(row, col) = expression;
         }
         return result;
     }
@@ -310,20 +470,100 @@ Affine operator*(const Variable &variable, const Parameter &parameter)
     }
 }
 
-Affine operator*(const Parameter &parameter, const Affine &affine)
+Affine operator*(const Parameter &parameter, Affine affine)
 {
-    if (not parameter.is_scalar())
+    if (parameter.is_scalar())
     {
-        throw std::runtime_error("This operation is not implemented for parameter matrices.");
+        for (auto [row, col] : affine.all_indices())
+        {
+            affine.coeffRef(row, col) *= parameter.coeff(0);
+        }
+        return affine;
     }
-    Affine result(affine.rows(), affine.cols());
+    if (affine.is_scalar())
+    {
+        Affine result(parameter.rows(), parameter.cols());
+        for (auto [row, col] : result.all_indices())
+        {
+            result.coeffRef(row, col) = affine.coeff(0) * parameter.coeff(row, col);
+        }
+        return result;
+    }
+
+    assert(parameter.cols() == affine.rows());
+
+    // The terms are merged with positions over the distinct variables of the affine matrix,
+    // since variable indices are not bounded, e.g. in a ProblemBuilder.
+    std::vector<size_t> distinct_variables;
     for (auto [row, col] : affine.all_indices())
     {
-        result.coeffRef(row, col) = affine.coeff(row, col) * parameter.coeff(0);
+        const auto &variables = affine.coeff(row, col).variables;
+        distinct_variables.insert(distinct_variables.end(), variables.begin(), variables.end());
+    }
+    std::sort(distinct_variables.begin(), distinct_variables.end());
+    distinct_variables.erase(std::unique(distinct_variables.begin(), distinct_variables.end()),
+                             distinct_variables.end());
+    std::vector<size_t> positions(distinct_variables.size(), 0);
+
+    Affine result(parameter.rows(), affine.cols());
+    std::vector<size_t> local_variables;
+    // read the parameter column by column in storage order
+    for (size_t col = 0; col < affine.cols(); col++)
+    {
+        for (size_t inner = 0; inner < parameter.cols(); inner++)
+        {
+            const internal::AffineSum &factor = affine.coeff(inner, col);
+            local_variables.clear();
+            for (size_t variable : factor.variables)
+            {
+                local_variables.push_back(std::lower_bound(distinct_variables.begin(), distinct_variables.end(), variable) -
+                                          distinct_variables.begin());
+            }
+            for (size_t row = 0; row < parameter.rows(); row++)
+            {
+                const internal::ParameterSource &coefficient = parameter.coeff(row, inner);
+                if (coefficient.is_zero())
+                {
+                    continue;
+                }
+                internal::AffineSum &expression = result.coeffRef(row, col);
+                for (size_t i = 0; i < factor.variables.size(); i++)
+                {
+                    internal::ParameterSource term = factor.coefficients[i] * coefficient;
+                    if (not term.is_zero())
+                    {
+                        expression.addTerm(term, local_variables[i]);
+                    }
+                }
+                for (const internal::ParameterSource &constant : factor.constants)
+                {
+                    expression.constants.push_back(constant * coefficient);
+                }
+            }
+        }
+    }
+    for (auto [row, col] : result.all_indices())
+    {
+        internal::AffineSum &expression = result.coeffRef(row, col);
+        expression.merge_variables(positions);
+        for (size_t &variable : expression.variables)
+        {
+            variable = distinct_variables[variable];
+        }
     }
     return result;
 }
 
+Affine operator*(Affine affine, const Parameter &parameter)
+{
+    if (parameter.is_scalar() or affine.is_scalar())
+    {
+        return parameter * std::move(affine);
+    }
+    // (affine * parameter)^T = parameter^T * affine^T
+    return (parameter.transpose() * affine.transpose()).transpose();
+}
+
 std::ostream &operator<<(std::ostream &os, const Affine &expression)
 {
     for (size_t row = 0; row < expression.rows(); row++)
@@ -351,11 +591,16 @@ Affine &Affine::operator+=(const Affine &other)
     return *this;
 }
 
-Affine Affine::operator-() const
+Affine Affine::operator-() const &
 {
     return Parameter(-1.0) * *this;
 }
 
+Affine Affine::operator-() &&
+{
+    return Parameter(-1.0) * std::move(*this);
+}
+
 Parameter::operator Affine() const
 {
     return Affine(*this);
@@ -369,17 +614,14 @@ Variable::operator Affine() const
 namespace internal
 {
 
-Norm2Term::Norm2Term(const Affine &affine)
+Norm2Term::Norm2Term(Affine affine)
 {
     assert(affine.rows() == 1 or affine.cols() == 1);
 
-    if (affine.rows() == 1)
-    {
-        arguments = affine.rowElements(0);
-    }
-    else
+    arguments.reserve(affine.size());
+    for (auto [row, col] : affine.all_indices())
     {
-        arguments = affine.colElements(0);
+        arguments.push_back(std::move(affine.coeffRef(row, col)));
     }
 }
 
@@ -394,19 +636,16 @@ double Norm2Term::evaluate(const std::vector<double> &soln_values) const
 
 } // namespace internal
 
-SOCLhs norm2(const Affine &affine)
+SOCLhs norm2(Affine affine)
 {
     assert(affine.rows() == 1 or affine.cols() == 1);
 
     SOCLhs socLhs;
-    for (auto [row, col] : affine.all_indices())
-    {
-        socLhs.coeffRef(0, 0).first.arguments.push_back(affine.coeff(row, col));
-    }
+    socLhs.coeffRef(0, 0).first = internal::Norm2Term(std::move(affine));
     return socLhs;
 }
 
-SOCLhs norm2(const Affine &affine, size_t axis)
+SOCLhs norm2(Affine affine, size_t axis)
 {
     assert(axis == 0 or axis == 1);
 
@@ -416,7 +655,7 @@ SOCLhs norm2(const Affine &affine, size_t axis)
         socLhs.resize(1, affine.cols());
         for (auto [row, col] : affine.all_indices())
         {
-            socLhs.coeffRef(0, col).first.arguments.push_back(affine.coeff(row, col));
+            socLhs.coeffRef(0, col).first.arguments.push_back(std::move(affine.coeffRef(row, col)));
         }
     }
     else if (axis == 1)
@@ -424,29 +663,30 @@ SOCLhs norm2(const Affine &affine, size_t axis)
         socLhs.resize(affine.rows(), 1);
         for (auto [row, col] : affine.all_indices())
         {
-            socLhs.coeffRef(row, 0).first.arguments.push_back(affine.coeff(row, col));
+            socLhs.coeffRef(row, 0).first.arguments.push_back(std::move(affine.coeffRef(row, col)));
         }
     }
     return socLhs;
 }
 
-Affine Parameter::cwiseProduct(const Affine &affine) const
+Affine Parameter::cwiseProduct(Affine affine) const
 {
     assert(affine.shape() == shape());
-    op::Affine product(rows(), cols());
     for (auto [row, col] : affine.all_indices())
     {
-        product.coeffRef(row, col) = affine.coeff(row, col) * coeff(row, col);
+        affine.coeffRef(row, col) *= coeff(row, col);
     }
-    return product;
+    return affine;
 }
 
 Affine sum(const Affine &affine)
 {
     op::Affine sum;
+    internal::AffineSum &total = sum.coeffRef(0);
+    total.reserve(affine.size());
     for (auto [row, col] : affine.all_indices())
     {
-        sum += affine(row, col);
+        total += affine.coeff(row, col);
     }
     return sum;
 }
@@ -489,23 +729,29 @@ Affine Variable::operator-() const
     return Parameter(-1.) * *this;
 }
 
-SOCLhs SOCLhs::operator+(const Affine &affine) const
+SOCLhs SOCLhs::operator+(Affine affine) const &
 {
     assert(affine.shape() == shape());
 
     SOCLhs result = *this;
 
-    result += affine;
+    result += std::move(affine);
 
     return result;
 }
 
-SOCLhs &SOCLhs::operator+=(const Affine &affine)
+SOCLhs SOCLhs::operator+(Affine affine) &&
+{
+    *this += std::move(affine);
+    return std::move(*this);
+}
+
+SOCLhs &SOCLhs::operator+=(Affine affine)
 {
     assert(affine.shape() == shape());
     for (auto [row, col] : all_indices())
     {
-        coeffRef(row, col).second += affine.coeff(row, col);
+        coeffRef(row, col).second += std::move(affine.coeffRef(row, col));
     }
     return *this;
 }
@@ -0,0 +1,34 @@
+#include "expressionArena.hpp"
+
+namespace op
+{
+
+namespace
+{
+
+thread_local std::pmr::memory_resource *current_resource = nullptr;
+
+} // namespace
+
+ArenaScope::ArenaScope(std::pmr::memory_resource *resource)
+    : previous(current_resource)
+{
+    current_resource = resource;
+}
+
+ArenaScope::~ArenaScope()
+{
+    current_resource = previous;
+}
+
+namespace internal
+{
+
+std::pmr::memory_resource *expressionResource()
+{
+    return current_resource ? current_resource : std::pmr::get_default_resource();
+}
+
+} // namespace internal
+
+} // namespace op
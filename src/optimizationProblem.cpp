@@ -8,18 +8,50 @@ namespace op
 
 size_t allocateVariableIndex();
 
+GenericOptimizationProblem::GenericOptimizationProblem(std::pmr::memory_resource *upstream)
+    : arena(std::make_shared<std::pmr::monotonic_buffer_resource>(upstream)) {}
+
+std::pmr::memory_resource *GenericOptimizationProblem::getArena() const
+{
+    return arena.get();
+}
+
 Variable GenericOptimizationProblem::createVariable(const std::string &name,
                                                     size_t rows, size_t cols)
 {
     Variable variable(name, solution_vector.size(), rows, cols);
-    variables.insert({name, variable});
+    if (variable_handles.emplace(name, variables.size()).second)
+    {
+        variables.push_back(variable);
+        variable_names.push_back(name);
+    }
     solution_vector.resize(solution_vector.size() + rows * cols);
     return variable;
 }
 
+size_t GenericOptimizationProblem::getVariableHandle(const std::string &name) const
+{
+    return variable_handles.at(name);
+}
+
+size_t GenericOptimizationProblem::getNumVariableHandles() const
+{
+    return variables.size();
+}
+
+const std::string &GenericOptimizationProblem::getVariableName(size_t handle) const
+{
+    return variable_names.at(handle);
+}
+
 Variable GenericOptimizationProblem::getVariable(const std::string &name) const
 {
-    return variables.at(name);
+    return variables[getVariableHandle(name)];
+}
+
+const Variable &GenericOptimizationProblem::getVariable(size_t handle) const
+{
+    return variables.at(handle);
 }
 
 size_t GenericOptimizationProblem::getNumVariables() const
@@ -30,7 +62,13 @@ size_t GenericOptimizationProblem::getNumVariables() const
 void GenericOptimizationProblem::readSolution(const std::string &name,
                                               double &solution) const
 {
-    const Variable &variable = variables.at(name);
+    readSolution(getVariableHandle(name), solution);
+}
+
+void GenericOptimizationProblem::readSolution(size_t handle,
+                                              double &solution) const
+{
+    const Variable &variable = variables.at(handle);
     assert(variable.is_scalar());
     solution = solution_vector[variable.coeff(0).getProblemIndex()];
 }
@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <cassert>
+#include <algorithm>
 
 namespace op
 {
@@ -16,7 +17,56 @@ ParameterSource::ParameterSource(double *value_ptr)
     : source(value_ptr) {}
 
 ParameterSource::ParameterSource(const std::function<double()> &callback)
-    : source(callback) {}
+    : source(std::make_shared<const std::function<double()>>(callback)) {}
+
+ParameterSource::ParameterSource(const ParameterMatrixElement &element)
+    : source(element) {}
+
+ParameterSource::ParameterSource(const ParameterBlockElement &element)
+    : source(element) {}
+
+ParameterSource::ParameterSource(ParameterOperation::Type type,
+                                 const ParameterSource &lhs,
+                                 const ParameterSource &rhs)
+{
+    if (type == ParameterOperation::Type::Add or type == ParameterOperation::Type::Multiply)
+    {
+        source = std::make_shared<ParameterOperation>(ParameterOperation{type, {}});
+        appendOperand(lhs);
+        appendOperand(rhs);
+    }
+    else
+    {
+        source = std::make_shared<ParameterOperation>(ParameterOperation{type, {lhs, rhs}});
+    }
+}
+
+bool ParameterSource::is_operation(ParameterOperation::Type type) const
+{
+    return is_operation() and std::get<3>(source)->type == type;
+}
+
+// appends an operand to a sum or product, operands of the same type are flattened
+void ParameterSource::appendOperand(ParameterSource operand)
+{
+    // copy the operation if it is shared with other parameters
+    auto &node = std::get<3>(source);
+    if (node.use_count() > 1)
+    {
+        node = std::make_shared<ParameterOperation>(*node);
+    }
+
+    ParameterOperation &operation = *node;
+    if (operand.is_operation(operation.type))
+    {
+        const auto &operands = std::get<3>(operand.source)->operands;
+        operation.operands.insert(operation.operands.end(), operands.begin(), operands.end());
+    }
+    else
+    {
+        operation.operands.push_back(operand);
+    }
+}
 
 double ParameterSource::get_value() const
 {
@@ -26,8 +76,43 @@ double ParameterSource::get_value() const
         return std::get<0>(source);
     case 1:
         return *std::get<1>(source);
+    case 2:
+        return (*std::get<2>(source))();
+    case 3:
+    {
+        const ParameterOperation &operation = *std::get<3>(source);
+        double result = operation.operands[0].get_value();
+        for (size_t i = 1; i < operation.operands.size(); i++)
+        {
+            const double operand = operation.operands[i].get_value();
+            switch (operation.type)
+            {
+            case ParameterOperation::Type::Add:
+                result += operand;
+                break;
+            case ParameterOperation::Type::Subtract:
+                result -= operand;
+                break;
+            case ParameterOperation::Type::Multiply:
+                result *= operand;
+                break;
+            case ParameterOperation::Type::Divide:
+                result /= operand;
+                break;
+            }
+        }
+        return result;
+    }
+    case 4:
+    {
+        const ParameterMatrixElement &element = std::get<4>(source);
+        return element.matrix->get_value(element.row, element.col);
+    }
     default:
-        return std::get<2>(source)();
+    {
+        const ParameterBlockElement &element = std::get<5>(source);
+        return element.block->values()(element.index);
+    }
     }
 }
 
@@ -46,6 +131,27 @@ bool ParameterSource::is_callback() const
     return source.index() == 2;
 }
 
+bool ParameterSource::is_operation() const
+{
+    return source.index() == 3;
+}
+
+bool ParameterSource::is_matrix_element() const
+{
+    return source.index() == 4;
+}
+
+bool ParameterSource::is_block_element() const
+{
+    return source.index() == 5;
+}
+
+const ParameterMatrixElement &ParameterSource::get_matrix_element() const
+{
+    assert(is_matrix_element());
+    return std::get<4>(source);
+}
+
 bool ParameterSource::is_zero() const
 {
     return is_constant() and std::abs(get_value()) < 1e-10;
@@ -58,6 +164,10 @@ bool ParameterSource::is_one() const
 
 ParameterSource ParameterSource::operator+(const ParameterSource &other) const
 {
+    if (is_zero())
+    {
+        return other;
+    }
     if (other.is_zero())
     {
         return *this;
@@ -67,10 +177,7 @@ ParameterSource ParameterSource::operator+(const ParameterSource &other) const
         return ParameterSource(get_value() + other.get_value());
     }
 
-    return ParameterSource([p1 = *this,
-                            p2 = other]() {
-        return p1.get_value() + p2.get_value();
-    });
+    return ParameterSource(ParameterOperation::Type::Add, *this, other);
 }
 
 ParameterSource ParameterSource::operator-(const ParameterSource &other) const
@@ -84,10 +191,7 @@ ParameterSource ParameterSource::operator-(const ParameterSource &other) const
         return ParameterSource(get_value() - other.get_value());
     }
 
-    return ParameterSource([p1 = *this,
-                            p2 = other]() {
-        return p1.get_value() - p2.get_value();
-    });
+    return ParameterSource(ParameterOperation::Type::Subtract, *this, other);
 }
 
 ParameterSource ParameterSource::operator*(const ParameterSource &other) const
@@ -96,15 +200,41 @@ ParameterSource ParameterSource::operator*(const ParameterSource &other) const
     {
         return ParameterSource(0.);
     }
+    if (is_one())
+    {
+        return other;
+    }
+    if (other.is_one())
+    {
+        return *this;
+    }
     if (is_constant() and other.is_constant())
     {
         return ParameterSource(get_value() * other.get_value());
     }
 
-    return ParameterSource([p1 = *this,
-                            p2 = other]() {
-        return p1.get_value() * p2.get_value();
-    });
+    return ParameterSource(ParameterOperation::Type::Multiply, *this, other);
+}
+
+ParameterSource &ParameterSource::operator+=(const ParameterSource &other)
+{
+    // extend an existing sum in place instead of copying it
+    if (is_operation(ParameterOperation::Type::Add) and not other.is_zero())
+    {
+        appendOperand(other);
+        return *this;
+    }
+    return *this = *this + other;
+}
+
+ParameterSource &ParameterSource::operator*=(const ParameterSource &other)
+{
+    if (is_operation(ParameterOperation::Type::Multiply) and not other.is_zero() and not other.is_one())
+    {
+        appendOperand(other);
+        return *this;
+    }
+    return *this = *this * other;
 }
 
 ParameterSource ParameterSource::operator/(const ParameterSource &other) const
@@ -120,14 +250,277 @@ ParameterSource ParameterSource::operator/(const ParameterSource &other) const
         return ParameterSource(get_value() / other.get_value());
     }
 
-    return ParameterSource([p1 = *this,
-                            p2 = other]() {
-        return p1.get_value() / p2.get_value();
-    });
+    return ParameterSource(ParameterOperation::Type::Divide, *this, other);
+}
+
+namespace
+{
+
+thread_local EvaluationScope *current_evaluation = nullptr;
+
+} // namespace
+
+EvaluationScope::EvaluationScope()
+    : previous(current_evaluation)
+{
+    current_evaluation = this;
+}
+
+EvaluationScope::~EvaluationScope()
+{
+    current_evaluation = previous;
+}
+
+double ParameterMatrix::get_value(size_t row, size_t col) const
+{
+    switch (type)
+    {
+    case Type::Elements:
+        return elements[col * rows + row].get_value();
+    case Type::Product:
+    {
+        double element = 0.;
+        for (size_t inner = 0; inner < operands[0]->cols; inner++)
+        {
+            element += operands[0]->get_value(row, inner) * operands[1]->get_value(inner, col);
+        }
+        return element;
+    }
+    case Type::Add:
+        return operands[0]->get_value(row, col) + operands[1]->get_value(row, col);
+    case Type::Subtract:
+        return operands[0]->get_value(row, col) - operands[1]->get_value(row, col);
+    case Type::CwiseProduct:
+        return operands[0]->get_value(row, col) * operands[1]->get_value(row, col);
+    case Type::Scale:
+        return elements[0].get_value() * operands[0]->get_value(row, col);
+    default: // Type::Callback
+    {
+        if (not current_evaluation)
+        {
+            return get_values()(row, col);
+        }
+        auto [cached, inserted] = current_evaluation->callback_values.try_emplace(this);
+        if (inserted)
+        {
+            cached->second = get_values();
+        }
+        return cached->second(row, col);
+    }
+    }
+}
+
+Eigen::MatrixXd ParameterMatrix::get_values() const
+{
+    switch (type)
+    {
+    case Type::Elements:
+    {
+        Eigen::MatrixXd values(rows, cols);
+        for (size_t i = 0; i < elements.size(); i++)
+        {
+            values(i) = elements[i].get_value();
+        }
+        return values;
+    }
+    case Type::Product:
+        return operands[0]->get_values() * operands[1]->get_values();
+    case Type::Add:
+        return operands[0]->get_values() + operands[1]->get_values();
+    case Type::Subtract:
+        return operands[0]->get_values() - operands[1]->get_values();
+    case Type::CwiseProduct:
+        return operands[0]->get_values().cwiseProduct(operands[1]->get_values());
+    case Type::Scale:
+        return elements[0].get_value() * operands[0]->get_values();
+    default: // Type::Callback
+    {
+        Eigen::MatrixXd values(rows, cols);
+        callback(values);
+        return values;
+    }
+    }
 }
 
 } // namespace internal
 
+// Returns the matrix operation that holds all coefficients of the parameter in place,
+// apart from its structural zeros, or nullptr if there is none.
+std::shared_ptr<const internal::ParameterMatrix> in_place_matrix(const Parameter &parameter)
+{
+    std::shared_ptr<const internal::ParameterMatrix> matrix;
+    for (auto [row, col] : parameter.all_indices())
+    {
+        const internal::ParameterSource &source = parameter.coeff(row, col);
+        if (source.is_matrix_element())
+        {
+            matrix = source.get_matrix_element().matrix;
+            break;
+        }
+        if (not source.is_zero())
+        {
+            return nullptr;
+        }
+    }
+    if (not matrix or matrix->rows != parameter.rows() or matrix->cols != parameter.cols())
+    {
+        return nullptr;
+    }
+
+    for (auto [row, col] : parameter.all_indices())
+    {
+        const internal::ParameterSource &source = parameter.coeff(row, col);
+        if (source.is_matrix_element())
+        {
+            const internal::ParameterMatrixElement &element = source.get_matrix_element();
+            if (element.matrix != matrix or element.row != row or element.col != col)
+            {
+                return nullptr;
+            }
+        }
+        else if (matrix->zeros.empty() or not matrix->zeros[col * matrix->rows + row] or not source.is_zero())
+        {
+            return nullptr;
+        }
+    }
+    return matrix;
+}
+
+// Returns the matrix operation that holds all coefficients of the parameter
+// in place or creates a new one that collects them.
+std::shared_ptr<const internal::ParameterMatrix> as_matrix(const Parameter &parameter)
+{
+    if (auto matrix = in_place_matrix(parameter))
+    {
+        return matrix;
+    }
+
+    auto matrix = std::make_shared<internal::ParameterMatrix>();
+    matrix->type = internal::ParameterMatrix::Type::Elements;
+    matrix->rows = parameter.rows();
+    matrix->cols = parameter.cols();
+    matrix->elements.reserve(parameter.size());
+    for (size_t col = 0; col < parameter.cols(); col++)
+    {
+        for (size_t row = 0; row < parameter.rows(); row++)
+        {
+            matrix->elements.push_back(parameter.coeff(row, col));
+        }
+    }
+    return matrix;
+}
+
+// Column major pattern of the coefficients that are constant zeros
+std::vector<bool> zero_pattern(const Parameter &parameter)
+{
+    std::vector<bool> zeros(parameter.size());
+    for (auto [row, col] : parameter.all_indices())
+    {
+        zeros[col * parameter.rows() + row] = parameter.coeff(row, col).is_zero();
+    }
+    return zeros;
+}
+
+// Coefficients of a matrix product that have no pair of nonzero factors.
+// Only the pairs of nonzero factors are visited, like in a sparse product.
+std::vector<bool> product_zero_pattern(const Parameter &lhs, const Parameter &rhs)
+{
+    // the nonzero rows of the columns of lhs in compressed column storage
+    std::vector<size_t> lhs_column_starts(lhs.cols() + 1, 0);
+    std::vector<size_t> lhs_rows;
+    for (size_t col = 0; col < lhs.cols(); col++)
+    {
+        for (size_t row = 0; row < lhs.rows(); row++)
+        {
+            if (not lhs.coeff(row, col).is_zero())
+            {
+                lhs_rows.push_back(row);
+            }
+        }
+        lhs_column_starts[col + 1] = lhs_rows.size();
+    }
+
+    std::vector<bool> zeros(lhs.rows() * rhs.cols(), true);
+    for (size_t col = 0; col < rhs.cols(); col++)
+    {
+        for (size_t inner = 0; inner < rhs.rows(); inner++)
+        {
+            if (rhs.coeff(inner, col).is_zero())
+            {
+                continue;
+            }
+            for (size_t i = lhs_column_starts[inner]; i < lhs_column_starts[inner + 1]; i++)
+            {
+                zeros[col * lhs.rows() + lhs_rows[i]] = false;
+            }
+        }
+    }
+    return zeros;
+}
+
+// Creates a parameter whose coefficients refer to the result of a matrix operation.
+// The structural zeros of the result stay constant zeros.
+Parameter matrix_operation(internal::ParameterMatrix::Type type,
+                           size_t rows, size_t cols,
+                           const std::vector<internal::ParameterSource> &elements,
+                           const std::vector<std::shared_ptr<const internal::ParameterMatrix>> &operands,
+                           std::vector<bool> zeros = {})
+{
+    if (std::find(zeros.begin(), zeros.end(), true) == zeros.end())
+    {
+        zeros.clear();
+    }
+    auto matrix = std::make_shared<const internal::ParameterMatrix>(
+        internal::ParameterMatrix{type, rows, cols, elements, operands, {}, std::move(zeros)});
+
+    Parameter parameter(rows, cols);
+    for (auto [row, col] : parameter.all_indices())
+    {
+        if (matrix->zeros.empty() or not matrix->zeros[col * rows + row])
+        {
+            parameter.coeffRef(row, col) = internal::ParameterSource(internal::ParameterMatrixElement{matrix, row, col});
+        }
+    }
+    return parameter;
+}
+
+ParameterBlock::ParameterBlock(size_t rows, size_t cols)
+    : block_values(Eigen::MatrixXd::Zero(rows, cols)) {}
+
+void ParameterBlock::touch()
+{
+    block_version++;
+}
+
+bool ParameterBlock::acquire()
+{
+    if (not(shared_buffer.load(std::memory_order_relaxed) & new_values))
+    {
+        return false;
+    }
+    front_buffer = shared_buffer.exchange(front_buffer, std::memory_order_acq_rel) & ~new_values;
+    assert(buffers[front_buffer].rows() == block_values.rows() and
+           buffers[front_buffer].cols() == block_values.cols());
+    block_values = buffers[front_buffer];
+    touch();
+    return true;
+}
+
+Eigen::MatrixXd &ParameterBlock::values()
+{
+    return block_values;
+}
+
+const Eigen::MatrixXd &ParameterBlock::values() const
+{
+    return block_values;
+}
+
+size_t ParameterBlock::version() const
+{
+    return block_version;
+}
+
 Parameter::Parameter(const double const_value)
 {
     resize(1, 1);
@@ -146,6 +539,29 @@ Parameter::Parameter(const std::function<double()> &callback)
     coeffRef(0) = internal::ParameterSource(callback);
 }
 
+Parameter::Parameter(size_t rows, size_t cols,
+                     const std::function<void(Eigen::Ref<Eigen::MatrixXd>)> &callback)
+{
+    auto matrix = std::make_shared<const internal::ParameterMatrix>(
+        internal::ParameterMatrix{internal::ParameterMatrix::Type::Callback, rows, cols, {}, {}, callback, {}});
+
+    resize(rows, cols);
+    for (auto [row, col] : all_indices())
+    {
+        coeffRef(row, col) = internal::ParameterSource(internal::ParameterMatrixElement{matrix, row, col});
+    }
+}
+
+Parameter::Parameter(ParameterBlock *block)
+{
+    resize(block->values().rows(), block->values().cols());
+    for (auto [row, col] : all_indices())
+    {
+        const size_t index = col * rows() + row;
+        coeffRef(row, col) = internal::ParameterSource(internal::ParameterBlockElement{block, index});
+    }
+}
+
 double Parameter::get_value(const size_t row, const size_t col) const
 {
     return coeff(row, col).get_value();
@@ -153,6 +569,13 @@ double Parameter::get_value(const size_t row, const size_t col) const
 
 Eigen::MatrixXd Parameter::get_values() const
 {
+    // evaluate the whole operation at once if possible
+    if (const auto matrix = in_place_matrix(*this);
+        matrix and matrix->type != internal::ParameterMatrix::Type::Elements)
+    {
+        return matrix->get_values();
+    }
+
     Eigen::MatrixXd result_matrix(rows(), cols());
 
     for (auto [row, col] : all_indices())
@@ -162,10 +585,34 @@ Eigen::MatrixXd Parameter::get_values() const
     return result_matrix;
 }
 
+bool Parameter::is_constant() const
+{
+    for (auto [row, col] : all_indices())
+    {
+        if (not coeff(row, col).is_constant())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 Parameter Parameter::operator+(const Parameter &other) const
 {
     assert(shape() == other.shape());
 
+    if (not is_scalar() and not (is_constant() and other.is_constant()))
+    {
+        std::vector<bool> zeros = zero_pattern(*this);
+        const std::vector<bool> other_zeros = zero_pattern(other);
+        for (size_t i = 0; i < zeros.size(); i++)
+        {
+            zeros[i] = zeros[i] and other_zeros[i];
+        }
+        return matrix_operation(internal::ParameterMatrix::Type::Add, rows(), cols(),
+                                {}, {as_matrix(*this), as_matrix(other)}, std::move(zeros));
+    }
+
     Parameter parameter(rows(), cols());
     for (auto [row, col] : all_indices())
     {
@@ -183,6 +630,18 @@ Parameter Parameter::operator-(const Parameter &other) const
 {
     assert(shape() == other.shape());
 
+    if (not is_scalar() and not (is_constant() and other.is_constant()))
+    {
+        std::vector<bool> zeros = zero_pattern(*this);
+        const std::vector<bool> other_zeros = zero_pattern(other);
+        for (size_t i = 0; i < zeros.size(); i++)
+        {
+            zeros[i] = zeros[i] and other_zeros[i];
+        }
+        return matrix_operation(internal::ParameterMatrix::Type::Subtract, rows(), cols(),
+                                {}, {as_matrix(*this), as_matrix(other)}, std::move(zeros));
+    }
+
     Parameter parameter(rows(), cols());
     for (auto [row, col] : all_indices())
     {
@@ -193,6 +652,12 @@ Parameter Parameter::operator-(const Parameter &other) const
 
 Parameter scaleMatrix(const internal::ParameterSource &scalar, const Parameter &matrix)
 {
+    if (not scalar.is_zero() and not (scalar.is_constant() and matrix.is_constant()))
+    {
+        return matrix_operation(internal::ParameterMatrix::Type::Scale, matrix.rows(), matrix.cols(),
+                                {scalar}, {as_matrix(matrix)}, zero_pattern(matrix));
+    }
+
     Parameter parameter(matrix.rows(), matrix.cols());
     for (auto [row, col] : matrix.all_indices())
     {
@@ -205,30 +670,15 @@ Parameter multiplyMatrices(const Parameter &matrix1, const Parameter &matrix2)
 {
     assert(matrix1.cols() == matrix2.rows());
 
-    Parameter parameter(matrix1.rows(), matrix2.cols());
-    for (size_t row = 0; row < matrix1.rows(); row++)
+    if (matrix1.is_constant() and matrix2.is_constant())
     {
-        for (size_t col = 0; col < matrix2.cols(); col++)
-        {
-            std::vector<internal::ParameterSource> row_vector(matrix1.cols());
-            std::vector<internal::ParameterSource> column_vector(matrix2.rows());
-            for (size_t inner = 0; inner < matrix1.cols(); inner++)
-            {
-                row_vector.at(inner) = matrix1.coeff(row, inner);
-                column_vector.at(inner) = matrix2.coeff(inner, col);
-            }
-            auto sum_op = [rv = row_vector, cv = column_vector] {
-                double element = 0;
-                for (size_t inner = 0; inner < rv.size(); inner++)
-                {
-                    element += rv[inner].get_value() * cv[inner].get_value();
-                }
-                return element;
-            };
-            parameter.coeffRef(row, col) = internal::ParameterSource(sum_op);
-        }
+        const Eigen::MatrixXd product = matrix1.get_values() * matrix2.get_values();
+        return Parameter(product);
     }
-    return parameter;
+
+    return matrix_operation(internal::ParameterMatrix::Type::Product, matrix1.rows(), matrix2.cols(),
+                            {}, {as_matrix(matrix1), as_matrix(matrix2)},
+                            product_zero_pattern(matrix1, matrix2));
 }
 
 Parameter Parameter::operator*(const Parameter &other) const
@@ -251,6 +701,30 @@ Parameter Parameter::operator*(const Parameter &other) const
     }
 }
 
+Parameter Parameter::cwiseProduct(const Parameter &other) const
+{
+    assert(shape() == other.shape());
+
+    if (not is_scalar() and not (is_constant() and other.is_constant()))
+    {
+        std::vector<bool> zeros = zero_pattern(*this);
+        const std::vector<bool> other_zeros = zero_pattern(other);
+        for (size_t i = 0; i < zeros.size(); i++)
+        {
+            zeros[i] = zeros[i] or other_zeros[i];
+        }
+        return matrix_operation(internal::ParameterMatrix::Type::CwiseProduct, rows(), cols(),
+                                {}, {as_matrix(*this), as_matrix(other)}, std::move(zeros));
+    }
+
+    Parameter parameter(rows(), cols());
+    for (auto [row, col] : all_indices())
+    {
+        parameter.coeffRef(row, col) = coeff(row, col) * other.coeff(row, col);
+    }
+    return parameter;
+}
+
 Parameter Parameter::operator/(const Parameter &other) const
 {
     assert(other.is_scalar());
@@ -0,0 +1,897 @@
+#include "parameterTape.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+namespace op
+{
+
+namespace internal
+{
+
+ParameterTape::Opcode ParameterTape::to_opcode(ParameterOperation::Type type)
+{
+    switch (type)
+    {
+    case ParameterOperation::Type::Add:
+        return Opcode::Add;
+    case ParameterOperation::Type::Subtract:
+        return Opcode::Subtract;
+    case ParameterOperation::Type::Multiply:
+        return Opcode::Multiply;
+    default: // ParameterOperation::Type::Divide
+        return Opcode::Divide;
+    }
+}
+
+size_t ParameterTape::addOutputs(const std::vector<ParameterSource> &parameters,
+                                 double factor)
+{
+    assert(not finalized);
+
+    const size_t offset = size();
+    for (const ParameterSource &parameter : parameters)
+    {
+        Copy copy{output_count, nullptr, factor, 0};
+        if (resolveCopy(parameter, copy))
+        {
+            copies.push_back(copy);
+        }
+        else
+        {
+            const size_t source = lower(parameter);
+            outputs.push_back({output_count, source, factor, register_signatures[source]});
+        }
+        output_count++;
+    }
+    return offset;
+}
+
+size_t ParameterTape::size() const
+{
+    return output_count;
+}
+
+bool ParameterTape::resolveCopy(const ParameterSource &parameter, Copy &copy)
+{
+    switch (parameter.source.index())
+    {
+    case 1:
+        copy.pointer = std::get<1>(parameter.source);
+        copy.signature = addSignature({0});
+        return true;
+    case 3:
+    {
+        // product of constants and a single other operand
+        const ParameterOperation &operation = *std::get<3>(parameter.source);
+        if (operation.type != ParameterOperation::Type::Multiply)
+        {
+            return false;
+        }
+        const ParameterSource *factor = nullptr;
+        for (const ParameterSource &operand : operation.operands)
+        {
+            if (operand.is_constant())
+            {
+                copy.factor *= operand.get_value();
+            }
+            else if (factor)
+            {
+                return false;
+            }
+            else
+            {
+                factor = &operand;
+            }
+        }
+        return factor and resolveCopy(*factor, copy);
+    }
+    case 4:
+    {
+        const ParameterMatrixElement &element = std::get<4>(parameter.source);
+        const ParameterMatrix &matrix = *element.matrix;
+        if (matrix.type == ParameterMatrix::Type::Elements)
+        {
+            return resolveCopy(matrix.elements[element.col * matrix.rows + element.row], copy);
+        }
+        if (matrix.type == ParameterMatrix::Type::Scale and matrix.elements[0].is_constant())
+        {
+            copy.factor *= matrix.elements[0].get_value();
+            return resolveCopy(ParameterSource(ParameterMatrixElement{matrix.operands[0], element.row, element.col}), copy);
+        }
+        return false;
+    }
+    case 5:
+    {
+        const ParameterBlockElement &element = std::get<5>(parameter.source);
+        copy.pointer = element.block->values().data() + element.index;
+        copy.signature = getBlockSignature(element.block);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+size_t ParameterTape::addRegister(double value, size_t signature)
+{
+    registers.push_back(value);
+    register_signatures.push_back(signature);
+    return registers.size() - 1;
+}
+
+size_t ParameterTape::addSignature(const std::vector<size_t> &blocks)
+{
+    auto [signature, inserted] = signature_indices.insert({blocks, signatures.size()});
+    if (inserted)
+    {
+        signatures.push_back(blocks);
+    }
+    return signature->second;
+}
+
+size_t ParameterTape::mergeSignatures(size_t signature1, size_t signature2)
+{
+    if (signature1 == signature2 or signature2 == 0)
+    {
+        return signature1;
+    }
+    if (signature1 == 0)
+    {
+        return signature2;
+    }
+
+    const auto key = std::minmax(signature1, signature2);
+    if (auto merged = merged_signatures.find(key); merged != merged_signatures.end())
+    {
+        return merged->second;
+    }
+
+    std::vector<size_t> merged_blocks;
+    std::set_union(signatures[signature1].begin(), signatures[signature1].end(),
+                   signatures[signature2].begin(), signatures[signature2].end(),
+                   std::back_inserter(merged_blocks));
+    const size_t merged = addSignature(merged_blocks);
+    merged_signatures[key] = merged;
+    return merged;
+}
+
+size_t ParameterTape::getBlockSignature(ParameterBlock *block)
+{
+    if (auto signature = block_signatures.find(block); signature != block_signatures.end())
+    {
+        return signature->second;
+    }
+
+    blocks.push_back(block);
+    const size_t signature = addSignature({blocks.size() - 1});
+    block_signatures[block] = signature;
+    return signature;
+}
+
+size_t ParameterTape::lower(const ParameterSource &parameter)
+{
+    // Every distinct value gets one register. Equal constants, pointers and callbacks
+    // as well as equal operations on the same registers are only evaluated once.
+    switch (parameter.source.index())
+    {
+    case 0:
+    {
+        // compare the bits so that -0. and NaN are handled correctly
+        const double value = std::get<0>(parameter.source);
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(value));
+        if (auto constant = constant_registers.find(bits); constant != constant_registers.end())
+        {
+            return constant->second;
+        }
+        const size_t result = addRegister(value, 0);
+        constant_registers[bits] = result;
+        return result;
+    }
+    case 1:
+        return loadPointer(std::get<1>(parameter.source), addSignature({0}));
+    case 2:
+    {
+        const auto &callback = std::get<2>(parameter.source);
+        if (auto load = callback_registers.find(callback.get()); load != callback_registers.end())
+        {
+            return load->second;
+        }
+        const size_t signature = addSignature({0});
+        const size_t result = addRegister(0., signature);
+        callback_loads.push_back({result, callback, nullptr, signature});
+        callback_registers[callback.get()] = result;
+        return result;
+    }
+    case 3:
+    {
+        // sums and products are evaluated from left to right
+        // shared operations are only lowered once
+        const auto &node = std::get<3>(parameter.source);
+        if (auto lowered = operation_nodes.find(node); lowered != operation_nodes.end())
+        {
+            return lowered->second;
+        }
+
+        const ParameterOperation &operation = *node;
+        assert(operation.operands.size() >= 2);
+        const Opcode opcode = to_opcode(operation.type);
+        size_t result = lower(operation.operands[0]);
+        for (size_t i = 1; i < operation.operands.size(); i++)
+        {
+            result = lowerOperation(opcode, result, lower(operation.operands[i]));
+        }
+        operation_nodes[node] = result;
+        return result;
+    }
+    case 4:
+    {
+        const ParameterMatrixElement &element = std::get<4>(parameter.source);
+        if (element.matrix->type == ParameterMatrix::Type::Elements)
+        {
+            return lower(element.matrix->elements[element.col * element.matrix->rows + element.row]);
+        }
+        return lowerMatrix(element.matrix) + element.col * element.matrix->rows + element.row;
+    }
+    default:
+    {
+        // block elements are loaded like pointers but only when the block has changed
+        const ParameterBlockElement &element = std::get<5>(parameter.source);
+        return loadPointer(element.block->values().data() + element.index, getBlockSignature(element.block));
+    }
+    }
+}
+
+size_t ParameterTape::lowerOperation(Opcode opcode, size_t lhs, size_t rhs)
+{
+    if ((opcode == Opcode::Add or opcode == Opcode::Multiply) and rhs < lhs)
+    {
+        std::swap(lhs, rhs);
+    }
+    const auto key = std::make_tuple(opcode, lhs, rhs);
+    if (auto operation_register = operation_registers.find(key); operation_register != operation_registers.end())
+    {
+        return operation_register->second;
+    }
+    const size_t signature = mergeSignatures(register_signatures[lhs], register_signatures[rhs]);
+    const size_t result = addRegister(0., signature);
+    instructions.push_back({opcode, result, lhs, rhs, signature, 0});
+    operation_registers[key] = result;
+    return result;
+}
+
+size_t ParameterTape::loadPointer(const double *pointer, size_t signature)
+{
+    const auto key = std::make_pair(pointer, signature);
+    if (auto load = pointer_registers.find(key); load != pointer_registers.end())
+    {
+        return load->second;
+    }
+    const size_t result = addRegister(0., signature);
+    pointer_loads.push_back({result, pointer, signature});
+    pointer_registers[key] = result;
+    return result;
+}
+
+size_t ParameterTape::lowerMatrix(const std::shared_ptr<const ParameterMatrix> &matrix)
+{
+    if (auto block = matrix_blocks.find(matrix); block != matrix_blocks.end())
+    {
+        return block->second;
+    }
+
+    if (matrix->type == ParameterMatrix::Type::Callback)
+    {
+        const size_t signature = addSignature({0});
+        const size_t result = registers.size();
+        registers.resize(result + matrix->rows * matrix->cols);
+        register_signatures.resize(registers.size(), signature);
+        callback_loads.push_back({result, nullptr, matrix, signature});
+        matrix_blocks[matrix] = result;
+        return result;
+    }
+
+    size_t signature = 0;
+    MatrixInstruction instruction{matrix->type, matrix->rows, matrix->cols, 0, {}, no_operand};
+    if (matrix->type == ParameterMatrix::Type::Scale)
+    {
+        instruction.scalar = lower(matrix->elements[0]);
+        signature = register_signatures[instruction.scalar];
+    }
+    for (const auto &operand : matrix->operands)
+    {
+        instruction.operands.push_back(lowerMatrixOperand(operand, signature));
+    }
+    chooseSparseOperand(instruction);
+
+    // another node with the same operation on the same registers was already lowered
+    std::vector<size_t> key{size_t(instruction.type), instruction.rows, instruction.cols, instruction.scalar};
+    for (const MatrixOperand &operand : instruction.operands)
+    {
+        key.insert(key.end(), {operand.rows, operand.cols, operand.block, operand.registers.size()});
+        key.insert(key.end(), operand.registers.begin(), operand.registers.end());
+        key.insert(key.end(), operand.nonzeros.begin(), operand.nonzeros.end());
+    }
+    if (auto block = matrix_registers.find(key); block != matrix_registers.end())
+    {
+        matrix_blocks[matrix] = block->second;
+        return block->second;
+    }
+
+    const size_t result = registers.size();
+    registers.resize(result + matrix->rows * matrix->cols);
+    register_signatures.resize(registers.size(), signature);
+    instructions.push_back({Opcode::MatrixOperation, result, matrix_instructions.size(), 0, signature, 0});
+    matrix_instructions.push_back(std::move(instruction));
+
+    matrix_blocks[matrix] = result;
+    matrix_registers[key] = result;
+    return result;
+}
+
+ParameterTape::MatrixOperand ParameterTape::lowerMatrixOperand(const std::shared_ptr<const ParameterMatrix> &matrix,
+                                                               size_t &signature)
+{
+    MatrixOperand operand{matrix->rows, matrix->cols, 0, {}, {}, {}, {}};
+    const size_t size = matrix->rows * matrix->cols;
+    if (matrix->type == ParameterMatrix::Type::Elements)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (not matrix->elements[i].is_zero())
+            {
+                operand.nonzeros.push_back(i);
+            }
+        }
+        // an operand without nonzeros keeps its zero registers
+        if (operand.nonzeros.empty() or operand.nonzeros.size() > max_sparse_density * size)
+        {
+            operand.nonzeros.clear();
+        }
+
+        // the structural zeros of a sparse operand are never written to values
+        operand.values.setZero(matrix->rows, matrix->cols);
+        for (size_t k = 0; k < (operand.nonzeros.empty() ? size : operand.nonzeros.size()); k++)
+        {
+            const size_t index = operand.nonzeros.empty() ? k : operand.nonzeros[k];
+            const size_t element_register = lower(matrix->elements[index]);
+            operand.registers.push_back(element_register);
+            signature = mergeSignatures(signature, register_signatures[element_register]);
+        }
+    }
+    else
+    {
+        operand.block = lowerMatrix(matrix);
+        signature = mergeSignatures(signature, register_signatures[operand.block]);
+        // the block holds all values, the nonzeros are only needed for sparse products
+        if (not matrix->zeros.empty())
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                if (not matrix->zeros[i])
+                {
+                    operand.nonzeros.push_back(i);
+                }
+            }
+            if (operand.nonzeros.size() > max_sparse_density * size)
+            {
+                operand.nonzeros.clear();
+            }
+        }
+    }
+    return operand;
+}
+
+void ParameterTape::chooseSparseOperand(MatrixInstruction &instruction)
+{
+    if (instruction.type == ParameterMatrix::Type::Product)
+    {
+        // the number of multiplications with a sparse lhs or rhs
+        const MatrixOperand &lhs = instruction.operands[0];
+        const MatrixOperand &rhs = instruction.operands[1];
+        const size_t lhs_cost = lhs.nonzeros.empty() ? 0 : lhs.nonzeros.size() * rhs.cols;
+        const size_t rhs_cost = rhs.nonzeros.empty() ? 0 : lhs.rows * rhs.nonzeros.size();
+        if (lhs_cost > 0 and (rhs_cost == 0 or lhs_cost <= rhs_cost))
+        {
+            instruction.sparse_operand = 0;
+        }
+        else if (rhs_cost > 0)
+        {
+            instruction.sparse_operand = 1;
+        }
+    }
+
+    for (size_t i = 0; i < instruction.operands.size(); i++)
+    {
+        MatrixOperand &operand = instruction.operands[i];
+        if (i != instruction.sparse_operand)
+        {
+            // a block is read in place, gathered coefficients need their positions in values
+            if (operand.registers.empty())
+            {
+                operand.nonzeros.clear();
+            }
+            continue;
+        }
+
+        // the pattern is built once, an update only writes the values
+        operand.values.resize(0, 0);
+        operand.sparse_values.resize(operand.rows, operand.cols);
+        operand.sparse_values.reserve(operand.nonzeros.size());
+        size_t k = 0;
+        for (size_t col = 0; col < operand.cols; col++)
+        {
+            operand.sparse_values.startVec(col);
+            for (; k < operand.nonzeros.size() and operand.nonzeros[k] / operand.rows == col; k++)
+            {
+                operand.sparse_values.insertBack(operand.nonzeros[k] % operand.rows, col) = 0.;
+            }
+        }
+        operand.sparse_values.finalize();
+    }
+}
+
+void ParameterTape::finalize()
+{
+    // Segments with fewer blocks come first.
+    // Since the signature of an instruction contains the signatures of its operands,
+    // every segment only depends on itself and the ones before it.
+    std::vector<size_t> order(signatures.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) { return signatures[a].size() < signatures[b].size(); });
+    std::vector<size_t> rank(signatures.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        rank[order[i]] = i;
+    }
+
+    // sort all lists by segment, the order within a segment is kept
+    auto by_segment = [&rank](const auto &a, const auto &b) { return rank[a.signature] < rank[b.signature]; };
+    std::stable_sort(pointer_loads.begin(), pointer_loads.end(), by_segment);
+    std::stable_sort(callback_loads.begin(), callback_loads.end(), by_segment);
+    computeLevels();
+    std::stable_sort(instructions.begin(), instructions.end(), [&rank](const auto &a, const auto &b) {
+        return std::make_pair(rank[a.signature], a.level) < std::make_pair(rank[b.signature], b.level);
+    });
+    std::stable_sort(outputs.begin(), outputs.end(), by_segment);
+    std::stable_sort(copies.begin(), copies.end(), by_segment);
+
+    // merge the copies into runs of at most chunk_size values
+    for (const Copy &copy : copies)
+    {
+        if (not copy_runs.empty())
+        {
+            CopyRun &run = copy_runs.back();
+            if (run.signature == copy.signature and run.factor == copy.factor and
+                run.index + run.count == copy.index and run.count < chunk_size)
+            {
+                if (run.count == 1)
+                {
+                    run.stride = copy.pointer - run.pointer;
+                    run.count++;
+                    continue;
+                }
+                if (copy.pointer == run.pointer + run.stride * ptrdiff_t(run.count))
+                {
+                    run.count++;
+                    continue;
+                }
+            }
+        }
+        copy_runs.push_back({copy.index, copy.pointer, 1, 1, copy.factor, copy.signature});
+    }
+    copies.clear();
+    copies.shrink_to_fit();
+
+    auto range_end = [&rank](const auto &list, size_t segment_rank) {
+        auto end = std::partition_point(list.begin(), list.end(),
+                                        [&](const auto &e) { return rank[e.signature] <= segment_rank; });
+        return size_t(std::distance(list.begin(), end));
+    };
+    Segment previous{0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        Segment segment{order[i],
+                        range_end(pointer_loads, i),
+                        range_end(callback_loads, i),
+                        range_end(instructions, i),
+                        0,
+                        range_end(outputs, i),
+                        range_end(copy_runs, i),
+                        0};
+        const bool empty = segment.pointer_loads_end == previous.pointer_loads_end and
+                           segment.callback_loads_end == previous.callback_loads_end and
+                           segment.instructions_end == previous.instructions_end and
+                           segment.outputs_end == previous.outputs_end and
+                           segment.copy_runs_end == previous.copy_runs_end;
+        if (empty)
+        {
+            continue;
+        }
+
+        for (size_t j = previous.instructions_end; j < segment.instructions_end; j++)
+        {
+            if (j + 1 == segment.instructions_end or instructions[j + 1].level != instructions[j].level)
+            {
+                level_ends.push_back(j + 1);
+            }
+        }
+        segment.levels_end = level_ends.size();
+
+        // chunks of consecutive runs with about chunk_size values
+        size_t chunk_values = 0;
+        for (size_t j = previous.copy_runs_end; j < segment.copy_runs_end; j++)
+        {
+            chunk_values += copy_runs[j].count;
+            if (chunk_values >= chunk_size or j + 1 == segment.copy_runs_end)
+            {
+                copy_chunk_ends.push_back(j + 1);
+                chunk_values = 0;
+            }
+        }
+        segment.copy_chunks_end = copy_chunk_ends.size();
+
+        segments.push_back(segment);
+        previous = segment;
+    }
+
+    finalized = true;
+}
+
+void ParameterTape::computeLevels()
+{
+    // The level of an instruction is one more than the highest level of the registers it reads.
+    // The instructions are still in the order they were lowered in, so operands come first.
+    std::vector<size_t> register_levels(registers.size(), 0);
+    for (Instruction &instruction : instructions)
+    {
+        size_t level = 0;
+        size_t result_size = 1;
+        if (instruction.opcode == Opcode::MatrixOperation)
+        {
+            const MatrixInstruction &matrix_instruction = matrix_instructions[instruction.lhs];
+            if (matrix_instruction.type == ParameterMatrix::Type::Scale)
+            {
+                level = register_levels[matrix_instruction.scalar];
+            }
+            for (const MatrixOperand &operand : matrix_instruction.operands)
+            {
+                if (operand.registers.empty())
+                {
+                    const auto begin = register_levels.begin() + operand.block;
+                    level = std::max(level, *std::max_element(begin, begin + operand.rows * operand.cols));
+                }
+                for (size_t operand_register : operand.registers)
+                {
+                    level = std::max(level, register_levels[operand_register]);
+                }
+            }
+            result_size = matrix_instruction.rows * matrix_instruction.cols;
+        }
+        else
+        {
+            level = std::max(register_levels[instruction.lhs], register_levels[instruction.rhs]);
+        }
+
+        instruction.level = level + 1;
+        std::fill_n(register_levels.begin() + instruction.result, result_size, instruction.level);
+    }
+}
+
+void ParameterTape::setThreadPool(ThreadPool *pool)
+{
+    thread_pool = pool;
+}
+
+void ParameterTape::setMinParallelChunks(size_t chunks)
+{
+    min_parallel_chunks = chunks;
+}
+
+void ParameterTape::invalidate()
+{
+    seen_versions.clear();
+}
+
+namespace
+{
+
+template <typename T>
+size_t releaseVector(std::vector<T> &elements)
+{
+    const size_t bytes = elements.capacity() * sizeof(T);
+    std::vector<T>().swap(elements);
+    return bytes;
+}
+
+// estimated with the value and three pointers and a color per node
+template <typename Map>
+size_t releaseMap(Map &map)
+{
+    size_t bytes = map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void *));
+    map.clear();
+    return bytes;
+}
+
+} // namespace
+
+size_t ParameterTape::compact()
+{
+    if (not finalized)
+    {
+        finalize();
+    }
+
+    size_t released = 0;
+    for (const auto &[key, result] : matrix_registers)
+    {
+        released += key.capacity() * sizeof(size_t);
+    }
+    for (const auto &[signature, index] : signature_indices)
+    {
+        released += signature.capacity() * sizeof(size_t);
+    }
+    released += releaseVector(register_signatures);
+    released += releaseVector(copies);
+    released += releaseMap(matrix_blocks);
+    released += releaseMap(operation_nodes);
+    released += releaseMap(constant_registers);
+    released += releaseMap(pointer_registers);
+    released += releaseMap(callback_registers);
+    released += releaseMap(operation_registers);
+    released += releaseMap(matrix_registers);
+    released += releaseMap(signature_indices);
+    released += releaseMap(merged_signatures);
+    released += releaseMap(block_signatures);
+    return released;
+}
+
+template <typename Chunk>
+void ParameterTape::runChunks(size_t n_chunks, const Chunk &chunk)
+{
+    if (thread_pool and n_chunks >= min_parallel_chunks)
+    {
+        // a std::function of a reference does not allocate
+        thread_pool->run(n_chunks, std::cref(chunk));
+    }
+    else
+    {
+        for (size_t i = 0; i < n_chunks; i++)
+        {
+            chunk(i);
+        }
+    }
+}
+
+template <typename Range>
+void ParameterTape::forChunks(size_t begin, size_t end, const Range &range)
+{
+    const size_t n_chunks = (end - begin + chunk_size - 1) / chunk_size;
+    runChunks(n_chunks, [&](size_t chunk) {
+        const size_t chunk_begin = begin + chunk * chunk_size;
+        range(chunk_begin, std::min(chunk_begin + chunk_size, end));
+    });
+}
+
+void ParameterTape::evaluateInstructions(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const Instruction &instruction = instructions[i];
+        if (instruction.opcode == Opcode::MatrixOperation)
+        {
+            evaluateMatrix(matrix_instructions[instruction.lhs], instruction.result);
+            continue;
+        }
+
+        const double lhs = registers[instruction.lhs];
+        const double rhs = registers[instruction.rhs];
+        double &result = registers[instruction.result];
+        switch (instruction.opcode)
+        {
+        case Opcode::Add:
+            result = lhs + rhs;
+            break;
+        case Opcode::Subtract:
+            result = lhs - rhs;
+            break;
+        case Opcode::Multiply:
+            result = lhs * rhs;
+            break;
+        case Opcode::Divide:
+            result = lhs / rhs;
+            break;
+        case Opcode::MatrixOperation:
+            break;
+        }
+    }
+}
+
+void ParameterTape::evaluateMatrix(MatrixInstruction &instruction, size_t result)
+{
+    auto get_operand = [this](MatrixOperand &operand) {
+        const double *values = registers.data() + operand.block;
+        if (not operand.registers.empty())
+        {
+            for (size_t i = 0; i < operand.registers.size(); i++)
+            {
+                operand.values(operand.nonzeros.empty() ? i : operand.nonzeros[i]) = registers[operand.registers[i]];
+            }
+            values = operand.values.data();
+        }
+        return Eigen::Map<const Eigen::MatrixXd>(values, operand.rows, operand.cols);
+    };
+
+    Eigen::Map<Eigen::MatrixXd> result_matrix(registers.data() + result,
+                                              instruction.rows, instruction.cols);
+    switch (instruction.type)
+    {
+    case ParameterMatrix::Type::Product:
+        if (instruction.sparse_operand == 0)
+        {
+            gatherSparse(instruction.operands[0]);
+            result_matrix.noalias() = instruction.operands[0].sparse_values * get_operand(instruction.operands[1]);
+        }
+        else if (instruction.sparse_operand == 1)
+        {
+            gatherSparse(instruction.operands[1]);
+            result_matrix.noalias() = get_operand(instruction.operands[0]) * instruction.operands[1].sparse_values;
+        }
+        else
+        {
+            result_matrix.noalias() = get_operand(instruction.operands[0]) * get_operand(instruction.operands[1]);
+        }
+        break;
+    case ParameterMatrix::Type::Add:
+        result_matrix = get_operand(instruction.operands[0]) + get_operand(instruction.operands[1]);
+        break;
+    case ParameterMatrix::Type::Subtract:
+        result_matrix = get_operand(instruction.operands[0]) - get_operand(instruction.operands[1]);
+        break;
+    case ParameterMatrix::Type::CwiseProduct:
+        result_matrix = get_operand(instruction.operands[0]).cwiseProduct(get_operand(instruction.operands[1]));
+        break;
+    case ParameterMatrix::Type::Scale:
+        result_matrix = registers[instruction.scalar] * get_operand(instruction.operands[0]);
+        break;
+    case ParameterMatrix::Type::Elements:
+    case ParameterMatrix::Type::Callback:
+        assert(false && "Elements and callbacks are not evaluated as matrix instructions.");
+        break;
+    }
+}
+
+void ParameterTape::gatherSparse(MatrixOperand &operand)
+{
+    double *values = operand.sparse_values.valuePtr();
+    for (size_t k = 0; k < operand.nonzeros.size(); k++)
+    {
+        values[k] = operand.registers.empty() ? registers[operand.block + operand.nonzeros[k]]
+                                              : registers[operand.registers[k]];
+    }
+}
+
+size_t ParameterTape::update(double *output)
+{
+    if (not finalized)
+    {
+        finalize();
+    }
+
+    for (size_t block = 1; block < blocks.size(); block++)
+    {
+        blocks[block]->acquire();
+    }
+
+    // A signature is stale if it contains a pointer, a callback or a block that has changed
+    // since the last update of this output. The registers of signatures that are not stale
+    // are up to date as well, since they were evaluated for the same versions.
+    auto [output_versions, first_update] = seen_versions.try_emplace(output, blocks.size());
+    std::vector<size_t> &versions = output_versions->second;
+    stale_signatures.assign(signatures.size(), first_update);
+    for (size_t signature = 0; signature < signatures.size(); signature++)
+    {
+        for (size_t block : signatures[signature])
+        {
+            if (block == 0 or blocks[block]->version() != versions[block])
+            {
+                stale_signatures[signature] = true;
+            }
+        }
+    }
+
+    size_t refreshed = 0;
+    Segment begin{0, 0, 0, 0, 0, 0, 0, 0};
+    for (const Segment &segment : segments)
+    {
+        if (stale_signatures[segment.signature])
+        {
+            forChunks(begin.pointer_loads_end, segment.pointer_loads_end, [this](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++)
+                {
+                    registers[pointer_loads[i].result] = *pointer_loads[i].pointer;
+                }
+            });
+
+            // callbacks run one after another on the thread of the update, never on the pool
+            for (size_t i = begin.callback_loads_end; i < segment.callback_loads_end; i++)
+            {
+                const CallbackLoad &load = callback_loads[i];
+                if (load.matrix)
+                {
+                    load.matrix->callback(Eigen::Map<Eigen::MatrixXd>(registers.data() + load.result,
+                                                                      load.matrix->rows, load.matrix->cols));
+                }
+                else
+                {
+                    registers[load.result] = (*load.callback)();
+                }
+            }
+
+            size_t level_begin = begin.instructions_end;
+            for (size_t level = begin.levels_end; level < segment.levels_end; level++)
+            {
+                forChunks(level_begin, level_ends[level], [this](size_t first, size_t last) {
+                    evaluateInstructions(first, last);
+                });
+                level_begin = level_ends[level];
+            }
+
+            forChunks(begin.outputs_end, segment.outputs_end, [this, output](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++)
+                {
+                    output[outputs[i].index] = registers[outputs[i].source] * outputs[i].factor;
+                }
+            });
+            refreshed += segment.outputs_end - begin.outputs_end;
+
+            runChunks(segment.copy_chunks_end - begin.copy_chunks_end, [&](size_t chunk) {
+                const size_t index = begin.copy_chunks_end + chunk;
+                const size_t first = index == 0 ? 0 : copy_chunk_ends[index - 1];
+                for (size_t i = first; i < copy_chunk_ends[index]; i++)
+                {
+                    const CopyRun &run = copy_runs[i];
+                    double *destination = output + run.index;
+                    if (run.stride == 1 and run.factor == 1.)
+                    {
+                        std::memcpy(destination, run.pointer, run.count * sizeof(double));
+                    }
+                    else if (run.stride == 1)
+                    {
+                        for (size_t j = 0; j < run.count; j++)
+                        {
+                            destination[j] = run.factor * run.pointer[j];
+                        }
+                    }
+                    else
+                    {
+                        for (size_t j = 0; j < run.count; j++)
+                        {
+                            destination[j] = run.factor * run.pointer[ptrdiff_t(j) * run.stride];
+                        }
+                    }
+                }
+            });
+            for (size_t i = begin.copy_runs_end; i < segment.copy_runs_end; i++)
+            {
+                refreshed += copy_runs[i].count;
+            }
+        }
+        begin = segment;
+    }
+
+    for (size_t block = 1; block < blocks.size(); block++)
+    {
+        versions[block] = blocks[block]->version();
+    }
+
+    return refreshed;
+}
+
+} // namespace internal
+
+} // namespace op
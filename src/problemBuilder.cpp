@@ -0,0 +1,85 @@
+#include "problemBuilder.hpp"
+
+#include <cassert>
+#include <iterator>
+
+namespace op
+{
+
+ProblemBuilder::ProblemBuilder(std::pmr::memory_resource *upstream)
+    : arena(std::make_shared<std::pmr::monotonic_buffer_resource>(upstream)) {}
+
+std::pmr::memory_resource *ProblemBuilder::getArena() const
+{
+    return arena.get();
+}
+
+Variable ProblemBuilder::createVariable(const std::string &name,
+                                        size_t rows, size_t cols)
+{
+    Variable variable(name, local_index | n_variables, rows, cols);
+    variable_names.push_back(name);
+    variable_shapes.emplace_back(rows, cols);
+    n_variables += rows * cols;
+    return variable;
+}
+
+void ProblemBuilder::addConstraint(std::vector<internal::EqualityConstraint> constraints)
+{
+    equalityConstraints.insert(equalityConstraints.end(),
+                               std::make_move_iterator(constraints.begin()),
+                               std::make_move_iterator(constraints.end()));
+}
+
+void ProblemBuilder::addConstraint(std::vector<internal::PositiveConstraint> constraints)
+{
+    positiveConstraints.insert(positiveConstraints.end(),
+                               std::make_move_iterator(constraints.begin()),
+                               std::make_move_iterator(constraints.end()));
+}
+
+void ProblemBuilder::addConstraint(std::vector<internal::SecondOrderConeConstraint> constraints)
+{
+    secondOrderConeConstraints.insert(secondOrderConeConstraints.end(),
+                                      std::make_move_iterator(constraints.begin()),
+                                      std::make_move_iterator(constraints.end()));
+}
+
+void ProblemBuilder::addMinimizationTerm(Affine affine)
+{
+    assert(affine.is_scalar());
+    costFunction += std::move(affine.coeffRef(0));
+}
+
+void ProblemBuilder::relocateVariables(size_t first_index)
+{
+    auto relocate = [first_index](internal::AffineSum &affine) {
+        for (size_t &variable : affine.variables)
+        {
+            if (variable & local_index)
+            {
+                variable = first_index + (variable & ~local_index);
+            }
+        }
+    };
+
+    relocate(costFunction);
+    for (auto &equalityConstraint : equalityConstraints)
+    {
+        relocate(equalityConstraint.affine);
+    }
+    for (auto &positiveConstraint : positiveConstraints)
+    {
+        relocate(positiveConstraint.affine);
+    }
+    for (auto &secondOrderConeConstraint : secondOrderConeConstraints)
+    {
+        relocate(secondOrderConeConstraint.affine);
+        for (auto &affineSum : secondOrderConeConstraint.norm2.arguments)
+        {
+            relocate(affineSum);
+        }
+    }
+}
+
+} // namespace op
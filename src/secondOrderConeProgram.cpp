@@ -2,29 +2,61 @@
 
 #include <iostream>
 #include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <iterator>
 
 namespace op
 {
 
 void SecondOrderConeProgram::addConstraint(std::vector<internal::EqualityConstraint> constraints)
 {
-    equalityConstraints.insert(equalityConstraints.end(), constraints.begin(), constraints.end());
+    equalityConstraints.insert(equalityConstraints.end(),
+                               std::make_move_iterator(constraints.begin()),
+                               std::make_move_iterator(constraints.end()));
 }
 
 void SecondOrderConeProgram::addConstraint(std::vector<internal::PositiveConstraint> constraints)
 {
-    positiveConstraints.insert(positiveConstraints.end(), constraints.begin(), constraints.end());
+    positiveConstraints.insert(positiveConstraints.end(),
+                               std::make_move_iterator(constraints.begin()),
+                               std::make_move_iterator(constraints.end()));
 }
 
 void SecondOrderConeProgram::addConstraint(std::vector<internal::SecondOrderConeConstraint> constraints)
 {
-    secondOrderConeConstraints.insert(secondOrderConeConstraints.end(), constraints.begin(), constraints.end());
+    secondOrderConeConstraints.insert(secondOrderConeConstraints.end(),
+                                      std::make_move_iterator(constraints.begin()),
+                                      std::make_move_iterator(constraints.end()));
 }
 
-void SecondOrderConeProgram::addMinimizationTerm(const Affine &affine)
+void SecondOrderConeProgram::addMinimizationTerm(Affine affine)
 {
     assert(affine.is_scalar());
-    costFunction += affine.coeff(0);
+    costFunction += std::move(affine.coeffRef(0));
+}
+
+void SecondOrderConeProgram::merge(ProblemBuilder builder)
+{
+    if (frozen)
+    {
+        throw std::runtime_error("Can not merge a builder into a frozen problem.");
+    }
+
+    builder.relocateVariables(getNumVariables());
+    for (size_t i = 0; i < builder.variable_names.size(); i++)
+    {
+        const auto [rows, cols] = builder.variable_shapes[i];
+        createVariable(builder.variable_names[i], rows, cols);
+    }
+
+    addConstraint(std::move(builder.equalityConstraints));
+    addConstraint(std::move(builder.positiveConstraints));
+    addConstraint(std::move(builder.secondOrderConeConstraints));
+    costFunction += std::move(builder.costFunction);
+
+    // the merged expressions still use the memory of the builder
+    builder_arenas.push_back(std::move(builder.arena));
 }
 
 std::ostream &operator<<(std::ostream &os, const SecondOrderConeProgram &socp)
@@ -36,6 +68,18 @@ std::ostream &operator<<(std::ostream &os, const SecondOrderConeProgram &socp)
     os << "Number of second order cone constraints: " << socp.secondOrderConeConstraints.size() << "\n";
     os << "\n";
 
+    // the expressions below refer to the variables by their index in x
+    os << "Variables:"
+       << "\n";
+    for (size_t handle = 0; handle < socp.getNumVariableHandles(); handle++)
+    {
+        const Variable &variable = socp.getVariable(handle);
+        const size_t start_index = variable.coeff(0).getProblemIndex();
+        os << socp.getVariableName(handle) << ": x[" << start_index << "] ... x[" << start_index + variable.size() - 1
+           << "] (" << variable.rows() << "x" << variable.cols() << ", row major)\n";
+    }
+    os << "\n";
+
     os << "Minimize:"
        << "\n";
     os << socp.costFunction << "\n";
@@ -90,6 +134,13 @@ bool check_constraint(double tol, double val, const T &constraint)
 
 bool SecondOrderConeProgram::isFeasible() const
 {
+    if (frozen)
+    {
+        throw std::runtime_error("The constraints of a frozen problem are not available.");
+    }
+
+    // the matrix callbacks are run once instead of once per coefficient
+    internal::EvaluationScope evaluation;
     const double tol = 0.01;
     bool feasible = true;
     auto check = [&](const auto &constraint) { return check_constraint(tol,
@@ -112,33 +163,84 @@ bool SecondOrderConeProgram::isFeasible() const
     return feasible;
 }
 
+template <typename T>
+size_t release_constraints(std::vector<T> &constraints)
+{
+    size_t bytes = constraints.capacity() * sizeof(T);
+    for (const T &constraint : constraints)
+    {
+        bytes += constraint.affine.allocated_bytes();
+        if constexpr (std::is_same_v<T, internal::SecondOrderConeConstraint>)
+        {
+            bytes += constraint.norm2.arguments.capacity() * sizeof(internal::AffineSum);
+            for (const internal::AffineSum &argument : constraint.norm2.arguments)
+            {
+                bytes += argument.allocated_bytes();
+            }
+        }
+    }
+    std::vector<T>().swap(constraints);
+    return bytes;
+}
+
+size_t SecondOrderConeProgram::freeze()
+{
+    size_t released = 0;
+    released += release_constraints(equalityConstraints);
+    released += release_constraints(positiveConstraints);
+    released += release_constraints(secondOrderConeConstraints);
+    released += costFunction.allocated_bytes();
+    // shrinking keeps the memory resource of the vectors
+    for (auto *terms : {&costFunction.coefficients, &costFunction.constants})
+    {
+        terms->clear();
+        terms->shrink_to_fit();
+    }
+    costFunction.variables.clear();
+    costFunction.variables.shrink_to_fit();
+    arena->release();
+    builder_arenas.clear();
+    frozen = true;
+    return released;
+}
+
+bool SecondOrderConeProgram::isFrozen() const
+{
+    return frozen;
+}
+
 void SecondOrderConeProgram::cleanUp()
 {
     // std::cout << "Cleaning up problem...\n";
 
     size_t variables_removed = 0;
 
-    variables_removed += costFunction.clean();
+    // repeated variables like in x + x are merged into one term before removing zeros
+    std::vector<size_t> positions(getNumVariables(), 0);
+    auto clean = [&positions](internal::AffineSum &affine) {
+        return affine.merge_variables(positions) + affine.clean();
+    };
+
+    variables_removed += clean(costFunction);
 
     for (auto &equalityConstraint : equalityConstraints)
     {
-        variables_removed += equalityConstraint.affine.clean();
+        variables_removed += clean(equalityConstraint.affine);
     }
     for (auto &positiveConstraint : positiveConstraints)
     {
-        variables_removed += positiveConstraint.affine.clean();
+        variables_removed += clean(positiveConstraint.affine);
     }
     for (auto &secondOrderConeConstraint : secondOrderConeConstraints)
     {
         { // Affine
-            variables_removed += secondOrderConeConstraint.affine.clean();
+            variables_removed += clean(secondOrderConeConstraint.affine);
         }
 
         { // Norm2
-            variables_removed += secondOrderConeConstraint.affine.clean();
             for (auto &affineSum : secondOrderConeConstraint.norm2.arguments)
             {
-                variables_removed += affineSum.clean();
+                variables_removed += clean(affineSum);
             }
         }
     }
@@ -0,0 +1,238 @@
+#include "parameterTape.hpp"
+#include "fixedWrapperBase.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+#include <new>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// Counts the heap allocations while counting is set
+static size_t allocations = 0;
+static bool counting = false;
+
+static void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept
+{
+    if (counting)
+    {
+        allocations++;
+    }
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return std::malloc(size ? size : 1);
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void *allocate_or_throw(size_t size, size_t alignment = alignof(std::max_align_t))
+{
+    if (void *memory = allocate(size, alignment))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size)
+{
+    return allocate_or_throw(size);
+}
+
+void *operator new[](size_t size)
+{
+    return allocate_or_throw(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, size_t(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, size_t(alignment));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, size_t(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, size_t(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+// Gives access to the standard form of a fixed-size problem
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+struct FixedProbe : op::FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>
+{
+    using op::FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::FixedWrapperBase;
+    using op::FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::updateParameters;
+
+    double G(size_t i) const { return this->parameter_values[this->G_data_CCS_offset + i]; }
+    double h(size_t i) const { return this->parameter_values[this->h_offset + i]; }
+};
+
+// Checks that updating the parameters of a problem again does not allocate,
+// and that a fixed-size problem can be built and updated without allocations
+int main()
+{
+    Eigen::Matrix3d matrix = Eigen::Matrix3d::Random();
+    double scalar = 2.;
+    op::ParameterBlock block(Eigen::Matrix2d::Random());
+
+    op::Parameter pointer_parameter(&matrix);
+    op::Parameter product = pointer_parameter * pointer_parameter + op::Parameter(&scalar) * pointer_parameter;
+    op::Parameter callback_parameter(2, 2, [&](Eigen::Ref<Eigen::MatrixXd> values) { values.setConstant(scalar); });
+    op::Parameter block_parameter(&block);
+    op::Parameter sum = block_parameter + callback_parameter;
+    Eigen::SparseMatrix<double> sparse(3, 3);
+    sparse.insert(0, 1) = 1.;
+    sparse.insert(2, 0) = 2.;
+    sparse.makeCompressed();
+    op::Parameter sparse_parameter(&sparse);
+    op::Parameter sparse_products = sparse_parameter * pointer_parameter + pointer_parameter * sparse_parameter;
+
+    op::internal::ParameterTape tape;
+    for (const op::Parameter *parameter : {&pointer_parameter, &product, &sum, &sparse_products})
+    {
+        std::vector<op::internal::ParameterSource> sources;
+        for (auto [row, col] : parameter->all_indices())
+        {
+            sources.push_back(parameter->coeff(row, col));
+        }
+        tape.addOutputs(sources, -1.);
+    }
+    tape.addOutputs({op::internal::ParameterSource([&scalar]() { return scalar * scalar; })});
+
+    std::vector<double> output(tape.size());
+    std::vector<double> staged_output(tape.size());
+    tape.update(output.data());
+    tape.update(staged_output.data());
+
+    for (int i = 0; i < 3; i++)
+    {
+        matrix.setRandom();
+        scalar += 1.;
+        block.set(Eigen::Matrix2d::Random());
+        sparse.coeffRef(2, 0) += 1.;
+
+        counting = true;
+        tape.update(output.data());
+        tape.update(staged_output.data());
+        counting = false;
+        assert(allocations == 0);
+    }
+    assert(std::abs(output[9] + (matrix * matrix + scalar * matrix)(0, 0)) < 1e-10);
+    assert(output.back() == scalar * scalar);
+
+    // a fixed-size problem is built, canonicalized and updated without allocations
+    {
+        Eigen::Matrix2d F = Eigen::Matrix2d::Random();
+        Eigen::Vector2d g = Eigen::Vector2d::Random();
+
+        counting = true;
+        op::FixedSecondOrderConeProgram<3, 6, 12> socp;
+        op::FixedVariable<2> x = socp.createVariable<2>();
+        op::FixedVariable<1> t = socp.createVariable<1>();
+        socp.addConstraint(op::norm2(op::FixedParameter<2, 2>(&F) * x + op::FixedParameter<2>(&g)) <= t);
+        socp.addConstraint(x >= 0.);
+        socp.addMinimizationTerm(op::FixedParameter<1>(&scalar) * t);
+        FixedProbe<3, 6, 12> probe(socp);
+        counting = false;
+        assert(allocations == 0);
+
+        for (int i = 0; i < 3; i++)
+        {
+            F.setRandom();
+            g.setRandom();
+
+            counting = true;
+            probe.updateParameters();
+            counting = false;
+            assert(allocations == 0);
+        }
+        // G holds the negative coefficients, the positive rows come before the cone
+        assert(probe.G(0) == -1. and probe.G(1) == -F(0, 0) and probe.G(2) == -F(1, 0));
+        assert(probe.h(3) == g(0) and probe.h(4) == g(1));
+    }
+
+    std::cout << "All tests were successful."
+              << "\n";
+}
@@ -0,0 +1,126 @@
+#include "secondOrderConeProgram.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// Evaluates the affine parts of the equality constraints at the solution vector
+Eigen::VectorXd evaluate_equalities(const op::SecondOrderConeProgram &socp)
+{
+    Eigen::VectorXd values(socp.equalityConstraints.size());
+    for (size_t i = 0; i < socp.equalityConstraints.size(); i++)
+    {
+        values(i) = socp.equalityConstraints[i].affine.evaluate(socp.solution_vector);
+    }
+    return values;
+}
+
+int main()
+{
+    Eigen::Matrix3d A;
+    A.setRandom();
+
+    // products with parameter matrices in a builder, whose variables are numbered when it is merged
+    {
+        op::SecondOrderConeProgram socp;
+        op::Variable x = socp.createVariable("x", 3);
+
+        op::ProblemBuilder builder;
+        op::Variable y = builder.createVariable("y", 3);
+        builder.addConstraint(op::Parameter(A) * (y + x) == 0.);
+        builder.addConstraint((y + x).transpose() * op::Parameter(A) == 0.);
+        socp.merge(std::move(builder));
+
+        Eigen::VectorXd solution = Eigen::VectorXd::Random(socp.getNumVariables());
+        socp.solution_vector.assign(solution.data(), solution.data() + solution.size());
+        Eigen::Vector3d xs, ys;
+        socp.readSolution("x", xs);
+        socp.readSolution("y", ys);
+        assert(socp.equalityConstraints.size() == 6);
+        assert(socp.equalityConstraints[0].affine.variables.size() == 6);
+        Eigen::VectorXd expected(6);
+        expected << A * (ys + xs), A.transpose() * (ys + xs);
+        assert((evaluate_equalities(socp) - expected).cwiseAbs().maxCoeff() < 1e-10);
+    }
+
+    // products of parameter matrices and affine expressions, with a structural zero row
+    {
+        op::SecondOrderConeProgram socp;
+        op::Variable u = socp.createVariable("u", 2);
+        op::Variable x = socp.createVariable("x", 3);
+        Eigen::MatrixXd B = Eigen::MatrixXd::Random(3, 2);
+        Eigen::SparseMatrix<double> sparse_A(4, 3);
+        sparse_A.insert(0, 0) = 1.;
+        sparse_A.insert(0, 2) = 2.;
+        sparse_A.insert(2, 1) = 3.;
+        sparse_A.insert(3, 0) = 4.;
+        sparse_A.insert(3, 1) = 5.;
+        sparse_A.insert(3, 2) = 6.;
+
+        socp.addConstraint(op::Parameter(sparse_A) * (op::Parameter(B) * u + x) == 0.);
+        assert(socp.equalityConstraints.size() == 4);
+        assert(socp.equalityConstraints[1].affine.variables.empty());
+        assert(socp.equalityConstraints[3].affine.variables.size() == 5);
+
+        Eigen::VectorXd solution = Eigen::VectorXd::Random(socp.getNumVariables());
+        socp.solution_vector.assign(solution.data(), solution.data() + solution.size());
+        Eigen::Vector2d us;
+        Eigen::Vector3d xs;
+        socp.readSolution("u", us);
+        socp.readSolution("x", xs);
+        const Eigen::VectorXd expected = Eigen::MatrixXd(sparse_A) * (B * us + xs);
+        assert((evaluate_equalities(socp) - expected).cwiseAbs().maxCoeff() < 1e-10);
+    }
+
+    // repeated variables are merged into one term and terms that cancel are removed
+    {
+        op::SecondOrderConeProgram socp;
+        op::Variable x = socp.createVariable("x");
+        op::Variable y = socp.createVariable("y");
+        socp.addConstraint(x + y + x == 0.);
+        socp.addConstraint(x + -x + y >= 0.);
+        socp.addMinimizationTerm(x);
+        socp.addMinimizationTerm(op::Parameter(3.) * x + y);
+        socp.cleanUp();
+
+        const op::internal::AffineSum &sum = socp.equalityConstraints[0].affine;
+        assert(sum.variables.size() == 2 and sum.variables[0] == x.coeff(0, 0).getProblemIndex());
+        assert(sum.coefficients[0].get_value() == 2. and sum.coefficients[1].get_value() == 1.);
+        const op::internal::AffineSum &difference = socp.positiveConstraints[0].affine;
+        assert(difference.variables.size() == 1 and difference.variables[0] == y.coeff(0, 0).getProblemIndex());
+        assert(socp.costFunction.variables.size() == 2 and socp.costFunction.variables[0] == x.coeff(0, 0).getProblemIndex());
+        assert(socp.costFunction.coefficients[0].get_value() == 4.);
+    }
+
+    // a scalar right hand side of several cones is compared with the affine part of each cone
+    {
+        op::SecondOrderConeProgram socp;
+        op::Variable X = socp.createVariable("X", 2, 2);
+        op::Variable y = socp.createVariable("y", 2);
+        op::Variable t = socp.createVariable("t");
+        socp.addConstraint(op::norm2(X, 0) + y.transpose() <= t);
+        assert(socp.secondOrderConeConstraints.size() == 2);
+
+        Eigen::VectorXd solution = Eigen::VectorXd::Random(socp.getNumVariables());
+        socp.solution_vector.assign(solution.data(), solution.data() + solution.size());
+        Eigen::Matrix2d Xs;
+        Eigen::Vector2d ys;
+        double ts;
+        socp.readSolution("X", Xs);
+        socp.readSolution("y", ys);
+        socp.readSolution("t", ts);
+        for (size_t i = 0; i < 2; i++)
+        {
+            const op::internal::SecondOrderConeConstraint &cone = socp.secondOrderConeConstraints[i];
+            assert(cone.affine.variables.size() == 2);
+            assert(std::abs(cone.affine.evaluate(socp.solution_vector) - (ts - ys(i))) < 1e-10);
+            assert(std::abs(cone.norm2.evaluate(socp.solution_vector) - Xs.col(i).norm()) < 1e-10);
+        }
+    }
+
+    std::cout << "All tests were successful."
+              << "\n";
+}
@@ -0,0 +1,186 @@
+#include "socpInterface.hpp"
+#include "fixedEicosWrapper.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Dense>
+
+// The sparsity structure and the values of the standard form of a solver
+struct StandardForm
+{
+    std::vector<int> sizes;
+    std::vector<int> cone_dimensions;
+    std::vector<int> G_columns;
+    std::vector<int> G_rows;
+    std::vector<int> A_columns;
+    std::vector<int> A_rows;
+    std::vector<double> values;
+};
+
+template <typename Values>
+static void append(std::vector<double> &values, const Values &source, size_t offset, size_t size)
+{
+    values.insert(values.end(), source.begin() + offset, source.begin() + offset + size);
+}
+
+// Reads the standard form of the dynamic canonicalization
+struct DynamicProbe : op::WrapperBase
+{
+    using op::WrapperBase::WrapperBase;
+    void initialize() override {}
+    bool solveProblem(bool) override { return true; }
+    std::string getResultString() const override { return ""; }
+
+    StandardForm standardForm()
+    {
+        updateParameters();
+        StandardForm form;
+        form.sizes = {n_variables, n_constraint_rows, n_equalities, n_positive_constraints, n_cone_constraints};
+        form.cone_dimensions = cone_constraint_dimensions;
+        form.G_columns = G_columns_CCS;
+        form.G_rows = G_rows_CCS;
+        form.A_columns = A_columns_CCS;
+        form.A_rows = A_rows_CCS;
+        append(form.values, parameter_values, c_offset, n_variables);
+        append(form.values, parameter_values, h_offset, n_constraint_rows);
+        append(form.values, parameter_values, b_offset, n_equalities);
+        append(form.values, parameter_values, G_data_CCS_offset, G_rows_CCS.size());
+        append(form.values, parameter_values, A_data_CCS_offset, A_rows_CCS.size());
+        return form;
+    }
+};
+
+// Reads the standard form of the fixed-size canonicalization
+template <size_t MaxVariables, size_t MaxRows, size_t MaxTerms>
+struct FixedProbe : op::FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>
+{
+    using op::FixedWrapperBase<MaxVariables, MaxRows, MaxTerms>::FixedWrapperBase;
+
+    StandardForm standardForm()
+    {
+        this->updateParameters();
+        StandardForm form;
+        int n_variables = this->n_variables;
+        form.sizes = {n_variables, this->n_constraint_rows, this->n_equalities,
+                      this->n_positive_constraints, this->n_cone_constraints};
+        form.cone_dimensions.assign(this->cone_constraint_dimensions.begin(),
+                                    this->cone_constraint_dimensions.begin() + this->n_cone_constraints);
+        form.G_columns.assign(this->G_columns_CCS.begin(), this->G_columns_CCS.begin() + n_variables + 1);
+        form.G_rows.assign(this->G_rows_CCS.begin(), this->G_rows_CCS.begin() + form.G_columns.back());
+        form.A_columns.assign(this->A_columns_CCS.begin(), this->A_columns_CCS.begin() + n_variables + 1);
+        form.A_rows.assign(this->A_rows_CCS.begin(), this->A_rows_CCS.begin() + form.A_columns.back());
+        append(form.values, this->parameter_values, this->c_offset, n_variables);
+        append(form.values, this->parameter_values, this->h_offset, this->n_constraint_rows);
+        append(form.values, this->parameter_values, this->b_offset, this->n_equalities);
+        append(form.values, this->parameter_values, this->G_data_CCS_offset, form.G_rows.size());
+        append(form.values, this->parameter_values, this->A_data_CCS_offset, form.A_rows.size());
+        return form;
+    }
+};
+
+static void assert_same(const StandardForm &lhs, const StandardForm &rhs)
+{
+    assert(lhs.sizes == rhs.sizes);
+    assert(lhs.cone_dimensions == rhs.cone_dimensions);
+    assert(lhs.G_columns == rhs.G_columns);
+    assert(lhs.G_rows == rhs.G_rows);
+    assert(lhs.A_columns == rhs.A_columns);
+    assert(lhs.A_rows == rhs.A_rows);
+    assert(lhs.values.size() == rhs.values.size());
+    for (size_t i = 0; i < lhs.values.size(); i++)
+    {
+        assert(std::abs(lhs.values[i] - rhs.values[i]) < 1e-12);
+    }
+}
+
+int main()
+{
+    Eigen::Matrix<double, 2, 3> A = Eigen::Matrix<double, 2, 3>::Random();
+    Eigen::Vector3d x0 = Eigen::Vector3d::Ones();
+    Eigen::Vector2d b = A * x0;
+    Eigen::Matrix3d B = 2. * Eigen::Matrix3d::Identity() + 0.1 * Eigen::Matrix3d::Random();
+    Eigen::Vector3d lower = -Eigen::Vector3d::Ones();
+    Eigen::Matrix<double, 1, 3> f = 0.1 * Eigen::Matrix<double, 1, 3>::Random();
+    double weight = 2.;
+
+    // the shapes of the expressions are part of their types
+    {
+        op::FixedSecondOrderConeProgram<4, 1, 1> socp;
+        op::FixedVariable<3> x = socp.createVariable<3>();
+        op::FixedVariable<1> t = socp.createVariable<1>();
+        static_assert(std::is_same_v<decltype(op::FixedParameter<2, 3>(&A) * x), op::FixedAffine<2, 1, 3>>);
+        static_assert(std::is_same_v<decltype(op::FixedParameter<1>(&weight) * x - x), op::FixedAffine<3, 1, 2>>);
+        static_assert(std::is_same_v<decltype(op::FixedParameter<1, 3>(f) * x + t), op::FixedAffine<1, 1, 4>>);
+        static_assert(std::is_same_v<decltype(op::norm2(x) <= t), op::internal::FixedSecondOrderConeConstraint<3, 1, 1>>);
+        assert(x.index(2) == 2 and t.index(0) == 3);
+        try
+        {
+            socp.createVariable<1>();
+            assert(false);
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+    }
+
+    // the same problem with dynamic and with fixed-size expressions
+    op::SecondOrderConeProgram socp;
+    op::Variable x = socp.createVariable("x", 3);
+    op::Variable t = socp.createVariable("t");
+    socp.addConstraint(op::Parameter(&A) * x == op::Parameter(&b));
+    socp.addConstraint(x + op::Parameter(2.) * x >= op::Parameter(lower));
+    socp.addConstraint(op::norm2(op::Parameter(&B) * x) <= op::Parameter(&weight) * t + op::Parameter(1.));
+    socp.addMinimizationTerm(op::Parameter(&f) * x);
+    socp.addMinimizationTerm(op::Parameter(&weight) * t);
+
+    op::FixedSecondOrderConeProgram<4, 12, 40> fixed_socp;
+    op::FixedVariable<3> fixed_x = fixed_socp.createVariable<3>();
+    op::FixedVariable<1> fixed_t = fixed_socp.createVariable<1>();
+    fixed_socp.addConstraint(op::FixedParameter<2, 3>(&A) * fixed_x == op::FixedParameter<2>(&b));
+    fixed_socp.addConstraint(fixed_x + 2. * fixed_x >= op::FixedParameter<3>(lower));
+    fixed_socp.addConstraint(op::norm2(op::FixedParameter<3, 3>(&B) * fixed_x) <= op::FixedParameter<1>(&weight) * fixed_t + op::FixedParameter<1>(1.));
+    fixed_socp.addMinimizationTerm(op::FixedParameter<1, 3>(&f) * fixed_x);
+    fixed_socp.addMinimizationTerm(op::FixedParameter<1>(&weight) * fixed_t);
+
+    // the canonicalization matches the dynamic one, also after the parameters have changed
+    {
+        DynamicProbe probe(socp);
+        FixedProbe<4, 12, 40> fixed_probe(fixed_socp);
+        assert_same(probe.standardForm(), fixed_probe.standardForm());
+
+        A.setRandom();
+        b = A * x0;
+        B(1, 2) += 0.5;
+        weight = 3.;
+        assert_same(probe.standardForm(), fixed_probe.standardForm());
+    }
+
+    // both are solved to the same solution
+    {
+        op::Solver solver(socp);
+        op::FixedEicosWrapper fixed_solver(fixed_socp);
+        solver.initialize();
+        fixed_solver.initialize();
+        for (int i = 0; i < 2; i++)
+        {
+            f.setRandom();
+            f *= 0.1;
+            assert(solver.solveProblem(false));
+            assert(fixed_solver.solveProblem(false));
+            assert(fixed_solver.getResultString() == solver.getResultString());
+
+            Eigen::VectorXd x_sol;
+            Eigen::Vector3d fixed_x_sol;
+            socp.readSolution("x", x_sol);
+            fixed_socp.readSolution(fixed_x, fixed_x_sol);
+            assert((x_sol - fixed_x_sol).cwiseAbs().maxCoeff() < 1e-9);
+        }
+    }
+
+    std::cout << "All tests were successful."
+              << "\n";
+}
@@ -1,9 +1,15 @@
 #include "parameter.hpp"
+#include "parameterTape.hpp"
 
 #include <iostream>
 #include <cassert>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 int main()
 {
@@ -37,6 +43,23 @@ int main()
     result_scalar = scalar_param_2 / scalar_param_ptr;
     assert(result_scalar.get_value() == 2.);
 
+    // long sums are flat
+    std::vector<double> values(100000, 0.5);
+    op::internal::ParameterSource sum(0.);
+    for (double &value : values)
+    {
+        sum += op::internal::ParameterSource(&value);
+    }
+    assert(sum.get_value() == 50000.);
+    values.back() = 1.5;
+    assert(sum.get_value() == 50001.);
+
+    // copies share the sum, extending one of them does not change the others
+    op::internal::ParameterSource doubled = sum;
+    doubled += sum;
+    assert(doubled.get_value() == 100002.);
+    assert(sum.get_value() == 50001.);
+
     // Matrix
     // multiply 2x2/2x2
     Eigen::Matrix2d dyn_matrix;
@@ -90,6 +113,68 @@ int main()
     m = scalar * m1 * m2;
     assert((result.get_values() - m).cwiseAbs().sum() < 1e-10);
 
+    // element-wise operations
+    result = eigen1.cwiseProduct(eigen2) + eigen1 - scalar_param_ptr * eigen2;
+    m = m1.cwiseProduct(m2) + m1 - scalar * m2;
+    assert((result.get_values() - m).cwiseAbs().sum() < 1e-10);
+
+    m1.setRandom();
+    m = m1.cwiseProduct(m2) + m1 - scalar * m2;
+    assert((result.get_values() - m).cwiseAbs().sum() < 1e-10);
+    assert(std::abs(result.get_value(1, 2) - m(1, 2)) < 1e-10);
+
+    // parameter blocks
+    op::ParameterBlock block(m1);
+    const size_t version = block.version();
+    result = op::Parameter(&block) * eigen2;
+    assert((result.get_values() - m1 * m2).cwiseAbs().sum() < 1e-10);
+
+    block.set(m2);
+    assert(block.version() > version);
+    assert((result.get_values() - m2 * m2).cwiseAbs().sum() < 1e-10);
+
+    // values published by another thread are taken as a whole
+    block.publish(m1);
+    assert((block.values() - m2).cwiseAbs().sum() == 0.);
+    assert(block.acquire());
+    assert((block.values() - m1).cwiseAbs().sum() == 0.);
+    assert(not block.acquire());
+
+    block.set(Eigen::Matrix3d::Zero());
+    std::thread producer([&block]() {
+        for (int i = 0; i < 10000; i++)
+        {
+            block.publish(Eigen::Matrix3d::Constant(i));
+        }
+    });
+    for (int i = 0; i < 10000; i++)
+    {
+        block.acquire();
+        assert((block.values().array() == block.values()(0, 0)).all());
+    }
+    producer.join();
+    block.acquire();
+    assert(block.values()(2, 2) == 9999.);
+
+    // matrix callbacks fill all values at once
+    int calls = 0;
+    op::Parameter callback_parameter(3, 3, [&](Eigen::Ref<Eigen::MatrixXd> values) {
+        calls++;
+        values = scalar * m2;
+    });
+    result = callback_parameter + eigen1;
+    assert((result.get_values() - (scalar * m2 + m1)).cwiseAbs().sum() < 1e-10);
+    assert(calls == 1);
+    {
+        op::internal::EvaluationScope evaluation;
+        result = callback_parameter * eigen1;
+        for (auto [row, col] : result.all_indices())
+        {
+            assert(std::abs(result.get_value(row, col) - (scalar * m2 * m1)(row, col)) < 1e-10);
+        }
+        assert(calls == 2);
+    }
+
     Eigen::MatrixXd m3x2(3, 2);
     Eigen::MatrixXd m2x5(2, 5);
     m3x2.setRandom();
@@ -100,6 +185,222 @@ int main()
 
     assert((result.get_values() - m).cwiseAbs().sum() < 1e-10);
 
+    // blocks, transposes and stacks
+    Eigen::MatrixXd m4x3(4, 3);
+    m4x3.setRandom();
+    op::Parameter parameter_4x3(m4x3);
+    assert(parameter_4x3.block(1, 1, 3, 2).get_values() == m4x3.block(1, 1, 3, 2));
+    assert(parameter_4x3.transpose().row(2).get_values() == m4x3.transpose().row(2));
+    assert(parameter_4x3.col(1).tail(2).get_values() == m4x3.col(1).tail(2));
+    assert(parameter_4x3.bottomRightCorner(2, 2).transpose().get_values() == m4x3.bottomRightCorner(2, 2).transpose());
+    op::Parameter modified_block = parameter_4x3.topRows(2);
+    modified_block.coeffRef(0, 0) = op::internal::ParameterSource(10.);
+    assert(modified_block.get_value(0, 0) == 10. and parameter_4x3.get_value(0, 0) == m4x3(0, 0));
+    // a transpose of a temporary owns strided storage, references into it stay valid on modification
+    op::Parameter transposed = op::Parameter(m4x3).transpose();
+    transposed.coeffRef(0, 1) = transposed.coeff(1, 0);
+    assert(transposed.get_value(0, 1) == m4x3(0, 1) and transposed.get_value(2, 3) == m4x3(3, 2));
+    result = op::vstack({parameter_4x3.topRows(1), parameter_4x3.bottomRows(3)});
+    assert(result.get_values() == m4x3);
+    result = op::hstack({parameter_4x3.rightCols(1), parameter_4x3.leftCols(2)});
+    assert(result.get_values().leftCols(1) == m4x3.rightCols(1));
+
+    // sparse matrices only have parameters for their stored coefficients
+    Eigen::SparseMatrix<double> sparse(4, 3);
+    sparse.insert(0, 0) = 1.;
+    sparse.insert(2, 1) = 2.;
+    sparse.insert(3, 2) = 3.;
+    sparse.makeCompressed();
+    op::Parameter sparse_parameter(sparse);
+    op::Parameter sparse_ptr_parameter(&sparse);
+    assert(sparse_parameter.get_values() == Eigen::MatrixXd(sparse));
+    assert(sparse_ptr_parameter.coeff(1, 0).is_zero() and sparse_ptr_parameter.coeff(2, 1).is_pointer());
+    sparse.coeffRef(2, 1) = 5.;
+    assert(sparse_ptr_parameter.get_value(2, 1) == 5.);
+    result = sparse_ptr_parameter.transpose() * sparse_ptr_parameter;
+    assert(result.coeff(0, 1).is_zero() and not result.coeff(1, 1).is_zero());
+    assert(result.get_values() == Eigen::MatrixXd(sparse.transpose() * sparse));
+    result = result + op::Parameter(&scalar) * result;
+    assert(result.coeff(1, 0).is_zero() and not result.coeff(2, 2).is_zero());
+    assert((result.get_values() - (1. + scalar) * Eigen::MatrixXd(sparse.transpose() * sparse)).cwiseAbs().sum() < 1e-10);
+
+    // the tape evaluates the same values as the parameters
+    {
+        op::ParameterBlock tape_block(m1);
+        op::Parameter pointer_matrix(&m2);
+        op::Parameter product = op::Parameter(&tape_block) * pointer_matrix + callback_parameter;
+        op::Parameter mixed = op::Parameter(&scalar) * op::Parameter(2.) + op::Parameter([&]() { return scalar * scalar; });
+        mixed = mixed + op::Parameter(&scalar) + op::Parameter(3.) - op::Parameter(&scalar) / op::Parameter(4.);
+
+        std::vector<std::pair<std::vector<op::internal::ParameterSource>, double>> groups = {
+            {{op::internal::ParameterSource(5.), op::internal::ParameterSource(&scalar)}, 1.},
+            {{mixed.coeff(0, 0)}, -2.},
+            {{}, -1.},
+        };
+        for (const op::Parameter *parameter : {&product, &sparse_parameter, &pointer_matrix})
+        {
+            for (auto [row, col] : parameter->all_indices())
+            {
+                groups[2].first.push_back(parameter->coeff(row, col));
+            }
+        }
+        groups[2].first.push_back(op::Parameter(&tape_block).coeff(1, 2) * product.coeff(2, 1));
+
+        op::internal::ParameterTape tape;
+        std::vector<size_t> offsets;
+        for (const auto &[sources, factor] : groups)
+        {
+            offsets.push_back(tape.addOutputs(sources, factor));
+        }
+        std::vector<double> output(tape.size());
+        for (int i = 0; i < 2; i++)
+        {
+            tape.update(output.data());
+            for (size_t group = 0; group < groups.size(); group++)
+            {
+                const auto &[sources, factor] = groups[group];
+                for (size_t j = 0; j < sources.size(); j++)
+                {
+                    assert(std::abs(output[offsets[group] + j] - factor * sources[j].get_value()) < 1e-10);
+                }
+            }
+            scalar += 1.;
+            m2.setRandom();
+            tape_block.set(Eigen::Matrix3d::Random());
+        }
+    }
+
+    // products with sparse operands are evaluated on their nonzeros only
+    {
+        Eigen::MatrixXd dense_3x2 = Eigen::MatrixXd::Random(3, 2);
+        Eigen::MatrixXd dense_2x4 = Eigen::MatrixXd::Random(2, 4);
+        op::Parameter gram = sparse_ptr_parameter.transpose() * sparse_ptr_parameter;
+        const std::vector<op::Parameter> products = {
+            sparse_ptr_parameter * op::Parameter(&dense_3x2),
+            op::Parameter(&dense_2x4) * sparse_ptr_parameter,
+            gram,
+            gram * op::Parameter(&dense_3x2),
+            op::Parameter(sparse) * op::Parameter(&dense_3x2) + sparse_ptr_parameter * op::Parameter(&dense_3x2),
+        };
+        op::internal::ParameterTape tape;
+        std::vector<size_t> offsets;
+        for (const op::Parameter &product : products)
+        {
+            std::vector<op::internal::ParameterSource> sources;
+            for (auto [row, col] : product.all_indices())
+            {
+                sources.push_back(product.coeff(row, col));
+            }
+            offsets.push_back(tape.addOutputs(sources));
+        }
+        std::vector<double> output(tape.size());
+        for (int i = 0; i < 2; i++)
+        {
+            tape.update(output.data());
+            for (size_t j = 0; j < products.size(); j++)
+            {
+                const Eigen::MatrixXd values = products[j].get_values();
+                size_t k = offsets[j];
+                for (auto [row, col] : products[j].all_indices())
+                {
+                    assert(std::abs(output[k++] - values(row, col)) < 1e-10);
+                }
+            }
+            sparse.coeffRef(0, 0) = 7.;
+            dense_3x2.setRandom();
+            dense_2x4.setRandom();
+        }
+    }
+
+    // an update only writes the outputs of the changed blocks, separately for every output buffer
+    {
+        op::ParameterBlock block_a(Eigen::Matrix2d::Random());
+        op::ParameterBlock block_b(Eigen::Vector3d::Random());
+        op::Parameter parameter_a(&block_a);
+        op::Parameter parameter_b(&block_b);
+        op::internal::ParameterTape tape;
+        std::vector<op::internal::ParameterSource> sources;
+        for (auto [row, col] : parameter_a.all_indices())
+        {
+            sources.push_back(parameter_a.coeff(row, col));
+        }
+        tape.addOutputs(sources);
+        tape.addOutputs({parameter_b.coeff(0, 0), parameter_b.coeff(1, 0), parameter_b.coeff(2, 0)}, 2.);
+        tape.addOutputs({parameter_a.coeff(0, 0) * parameter_b.coeff(1, 0), op::internal::ParameterSource(7.)});
+
+        std::vector<double> output_1(tape.size()), output_2(tape.size());
+        assert(tape.update(output_1.data()) == 9);
+        assert(tape.update(output_1.data()) == 0);
+        assert(tape.update(output_2.data()) == 9);
+
+        block_b.set(Eigen::Vector3d::Random());
+        assert(tape.update(output_1.data()) == 4);
+        assert(tape.update(output_1.data()) == 0);
+        assert(output_1[5] == 2. * block_b.values()(1) and output_1[7] == block_a.values()(0, 0) * block_b.values()(1));
+
+        block_a.touch();
+        assert(tape.update(output_2.data()) == 8);
+        assert(tape.update(output_1.data()) == 5);
+        assert(output_1 == output_2);
+    }
+
+    // a tape evaluated on a thread pool writes the same values as on the calling thread
+    {
+        const size_t n = 3 * op::internal::ParameterTape::chunk_size;
+        Eigen::VectorXd a = Eigen::VectorXd::Random(n);
+        Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+        op::Parameter parameter_a(&a);
+        op::Parameter values = parameter_a.cwiseProduct(op::Parameter(&b)) + op::Parameter(&scalar) * parameter_a;
+        std::vector<op::internal::ParameterSource> sources;
+        for (const op::Parameter *parameter : {&parameter_a, &values})
+        {
+            for (auto [row, col] : parameter->all_indices())
+            {
+                sources.push_back(parameter->coeff(row, col));
+            }
+        }
+
+        op::internal::ThreadPool pool(4);
+        op::internal::ParameterTape serial_tape, parallel_tape;
+        serial_tape.addOutputs(sources, -1.);
+        parallel_tape.addOutputs(sources, -1.);
+        parallel_tape.setThreadPool(&pool);
+        parallel_tape.setMinParallelChunks(1);
+        std::vector<double> serial_output(serial_tape.size()), parallel_output(parallel_tape.size());
+        for (int i = 0; i < 2; i++)
+        {
+            serial_tape.update(serial_output.data());
+            parallel_tape.update(parallel_output.data());
+            assert(serial_output == parallel_output);
+            a.setRandom();
+            scalar += 1.;
+        }
+
+        // an exception of a task is passed to the caller once all threads are done
+        bool thrown = false;
+        try
+        {
+            pool.run(100, [](size_t task) {
+                if (task == 50)
+                {
+                    throw std::runtime_error("task failed");
+                }
+            });
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+        size_t tasks = 0;
+        std::mutex tasks_mutex;
+        pool.run(100, [&](size_t) {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            tasks++;
+        });
+        assert(tasks == 100);
+    }
+
     std::cout << "All tests were successful."
               << "\n";
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 int main()
 {
+    std::vector<double> construction_times;
     std::vector<double> solve_times;
 
     // assets, factors pair
@@ -43,6 +44,8 @@ int main()
         auto t0 = std::chrono::high_resolution_clock::now();
 
         op::SecondOrderConeProgram socp;
+        // allocate the expressions from the arena of the problem
+        op::ArenaScope arena_scope(socp.getArena());
 
         op::Variable x = socp.createVariable("x", n);
         op::Variable t = socp.createVariable("t");
@@ -63,6 +66,7 @@ int main()
         // Create and initialize the solver instance.
         op::Solver solver(socp);
         solver.initialize();
+        construction_times.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count());
 
         // Solve the problem and show solver output.
         double total_time = 0.;
@@ -84,9 +88,9 @@ int main()
         solve_times.push_back(total_time / repetitions);
     }
 
-    fmt::print("\nAverage times:\n");
+    fmt::print("\nConstruction and average solve times:\n");
     for (size_t i = 0; i < sets.size(); i++)
     {
-        fmt::print("{},\n", solve_times[i]);
+        fmt::print("{}, {},\n", construction_times[i], solve_times[i]);
     }
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <array>
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <algorithm>
 
 #include <Eigen/Dense>
 
@@ -101,11 +103,51 @@ int main()
               << x_sol << "\n\n";
 
     // Change the problem parameters and solve again.
+    // The handle avoids the lookup by name.
+    const size_t x_handle = socp.getVariableHandle("x");
     f.setRandom();
     solver.solveProblem(false);
     socp.readSolution("x", x_sol);
+    Eigen::Matrix<double, n, 1> x_sol_by_handle;
+    socp.readSolution(x_handle, x_sol_by_handle);
+    assert(x_sol_by_handle == x_sol);
 
     // Print the new solution.
     std::cout << "Solution after changing the cost function:\n"
               << x_sol << "\n\n";
+
+    // Parameters staged in the background give the same solution as an update in solveProblem().
+    f.setRandom();
+    solver.stageParameters();
+    solver.solveProblem(false);
+    Eigen::Matrix<double, n, 1> x_sol_staged;
+    socp.readSolution(x_handle, x_sol_staged);
+    solver.solveProblem(false);
+    socp.readSolution(x_handle, x_sol);
+    assert(x_sol_staged == x_sol);
+
+    // The calibration selects one of its candidates and does not change the solution.
+    const op::ParameterEvaluationStrategy strategy = solver.calibrateParameterEvaluation(2);
+    const bool is_power_of_two = (strategy.threads & (strategy.threads - 1)) == 0;
+    assert(strategy.threads >= 1 and is_power_of_two and strategy.threads <= std::max(std::thread::hardware_concurrency(), 1u));
+    assert(strategy.threads == 1 ? strategy.min_parallel_chunks == 8
+                                 : (strategy.min_parallel_chunks == 2 or strategy.min_parallel_chunks == 8 or strategy.min_parallel_chunks == 32));
+    solver.solveProblem(false);
+    Eigen::Matrix<double, n, 1> x_sol_calibrated;
+    socp.readSolution(x_handle, x_sol_calibrated);
+    assert(x_sol_calibrated == x_sol);
+
+    // A frozen problem can be solved again, but no new solver can be created from it.
+    solver.freeze();
+    solver.solveProblem(false);
+    bool rejected = false;
+    try
+    {
+        op::Solver other_solver(socp);
+    }
+    catch (const std::runtime_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "threadPool.hpp"
+
+namespace op
+{
+
+namespace internal
+{
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    for (size_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_condition.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::run(size_t n_tasks, const std::function<void(size_t)> &task)
+{
+    if (workers.empty() or n_tasks < 2)
+    {
+        for (size_t i = 0; i < n_tasks; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->n_tasks = n_tasks;
+        next_task = 0;
+        busy_workers = workers.size();
+        generation++;
+    }
+    start_condition.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_condition.wait(lock, [this] { return busy_workers == 0; });
+    this->task = nullptr;
+    if (first_exception)
+    {
+        std::exception_ptr exception = std::move(first_exception);
+        first_exception = nullptr;
+        lock.unlock();
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::work()
+{
+    size_t seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_condition.wait(lock, [&] { return stopping or generation != seen_generation; });
+            if (stopping)
+            {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy_workers == 0)
+        {
+            done_condition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    for (size_t i = next_task++; i < n_tasks; i = next_task++)
+    {
+        try
+        {
+            (*task)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (not first_exception)
+            {
+                first_exception = std::current_exception();
+            }
+            next_task = n_tasks;
+        }
+    }
+}
+
+} // namespace internal
+
+} // namespace op
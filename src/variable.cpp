@@ -8,9 +8,8 @@ namespace op
 namespace internal
 {
 
-VariableSource::VariableSource(const std::string &name, size_t problem_index,
-                               size_t row, size_t col)
-    : name(name), problem_index(problem_index), index(row, col) {}
+VariableSource::VariableSource(size_t problem_index)
+    : problem_index(problem_index) {}
 
 size_t VariableSource::getProblemIndex() const
 {
@@ -19,9 +18,7 @@ size_t VariableSource::getProblemIndex() const
 
 std::ostream &operator<<(std::ostream &os, const VariableSource &variable)
 {
-    os << variable.name
-       << "[" << variable.index.first << ", " << variable.index.second << "]"
-       << "@(" << variable.problem_index << ")";
+    os << "x[" << variable.problem_index << "]";
     return os;
 }
 
@@ -36,7 +33,7 @@ Variable::Variable(const std::string &name, size_t start_index,
     size_t index = start_index;
     for (auto [row, col] : all_indices())
     {
-        coeffRef(row, col) = internal::VariableSource(name, index, row, col);
+        coeffRef(row, col) = internal::VariableSource(index);
         index++;
     }
 }